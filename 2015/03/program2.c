@@ -5,253 +5,250 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
+# include <stdint.h>     /* uint32_t, uint64_t   */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
-# include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
+# include <string.h>     /* memset()             */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2015
-# define DAY     3
-# define PART    2
+AOC_STREAM_PROGRAM(2015, 3, 2);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
-
-# define MAX_LEN 10240
-
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
 
+/*
+ * The houses that have been visited are marked in tiles of TILE x TILE
+ * bits, which are only added for the parts of the grid the route goes
+ * through. The tiles are found through an open addressing table that's
+ * kept at most half full. The coordinates are shifted by BIAS, so they
+ * can be split into tile and offset without worrying about the sign.
+ */
+# define TILE 64
+# define BIAS 0x80000000u
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+struct tile {
+    uint32_t row, col;          /* In tiles */
+    uint64_t seen[TILE];
+} *tiles = NULL;
+int t_tiles, s_tiles;
 
+int *table = NULL;
+int table_size;
+int last_tile;
 
-/*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
- */
-int
-main(int argc, char *argv[], char *env[])
+static uint32_t
+hash_tile(uint32_t row, uint32_t col)
 {
-    parse_options(&argc, &argv);
+    uint32_t hash = 2166136261u;
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
+    for (int i = 0; i < 4; i++) {
+        hash = (hash ^ ((row >> (i * 8)) & 0xff)) * 16777619u;
     }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
+    for (int i = 0; i < 4; i++) {
+        hash = (hash ^ ((col >> (i * 8)) & 0xff)) * 16777619u;
+    }
+    return hash;
+}
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+static void
+table_grow()
+{
+    free(table);
+    table_size = table_size ? table_size * 2 : 1024;
+    table = malloc(table_size * sizeof(int));
+    if (table == NULL) {
+        printf("Oops. Failed to allocate the tile table.\n");
+        exit(1);
+    }
+    for (int i = 0; i < table_size; i++) {
+        table[i] = -1;
+    }
+    for (int t = 0; t < t_tiles; t++) {
+        uint32_t slot = hash_tile(tiles[t].row, tiles[t].col) & (table_size - 1);
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
+        while (table[slot] != -1) {
+            slot = (slot + 1) & (table_size - 1);
         }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
-        }
-        process_file(fd);
-        fclose(fd);
+        table[slot] = t;
     }
 }
 
-# define SEEN_OFFSET 100
-
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * Find the tile, adding an empty one if it's new. Most steps stay in
+ * the same tile as the one before, so that one is tried first.
  */
-void
-process_file(FILE *fd)
+static struct tile *
+find_tile(uint32_t row, uint32_t col)
 {
-    char buf[MAX_LEN + 1];
-
-    bool seen[200][200];
-    for (int row = 0; row < 200; row++) {
-        for (int col = 0; col < 200; col++) {
-            seen[row][col] = false;
-        }
+    if (last_tile != -1 && tiles[last_tile].row == row && tiles[last_tile].col == col) {
+        return &tiles[last_tile];
     }
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
 
-            SHA256((unsigned char *)buf, strlen(buf), digest);
+    uint32_t slot = hash_tile(row, col) & (table_size - 1);
 
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
+    while (table[slot] != -1) {
+        struct tile *tile = &tiles[table[slot]];
 
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
+        if (tile->row == row && tile->col == col) {
+            last_tile = table[slot];
+            return tile;
         }
-        int row[2] = { 0, 0 };
-        int col[2] = { 0, 0 };
-        int max_row = 0, min_row = 0, max_col = 0, min_col = 0;
-        int t_seen = 1;
-        seen[row[0] + SEEN_OFFSET][col[0] + SEEN_OFFSET] = true;
-        for (int i = 0; i < strlen(buf); i++) {
-            int index = i % 2;
-            switch (buf[i]) {
-            case '^':
-                row[index]--;
-                if (row[index] < min_row) {
-                    min_row = row[index];
-                }
-                break;
-            case '>':
-                col[index]++;
-                if (col[index] > max_col) {
-                    max_col = col[index];
-                }
-                break;
-            case 'v':
-                row[index]++;
-                if (row[index] > max_row) {
-                    max_row = row[index];
-                }
-                break;
-            case '<':
-                col[index]--;
-                if (col[index] < min_col) {
-                    min_col = col[index];
-                }
-                break;
-            }
-            if (!seen[row[index] + SEEN_OFFSET][col[index] + SEEN_OFFSET]) {
-                t_seen++;
-                seen[row[index] + SEEN_OFFSET][col[index] + SEEN_OFFSET] = true;
-            }
+        slot = (slot + 1) & (table_size - 1);
+    }
+    if (t_tiles == s_tiles) {
+        s_tiles = s_tiles ? s_tiles * 2 : 256;
+        tiles = realloc(tiles, s_tiles * sizeof(struct tile));
+        if (tiles == NULL) {
+            printf("Oops. Failed to grow the tiles to %d.\n", s_tiles);
+            exit(1);
         }
-        printf("Row range: %d - %d\n", min_row, max_row);
-        printf("Col range: %d - %d\n", min_col, max_col);
-        printf("Houses visited, once or more: %d\n", t_seen);
     }
-    if (opts.debug) {
-        printf("DEBUG: End of file\n");
+    struct tile *tile = &tiles[t_tiles];
+    tile->row = row;
+    tile->col = col;
+    memset(tile->seen, 0, sizeof(tile->seen));
+    table[slot] = t_tiles;
+    last_tile = t_tiles;
+    t_tiles++;
+    if (t_tiles * 2 > table_size) {
+        table_grow();
     }
+    return &tiles[last_tile];
 }
 
-
 /*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
+ * Mark the house as visited, returning whether it's the first time.
  */
-void
-parse_options(int *argc, char **argv[])
+static bool
+visit(int row, int col)
 {
-    int ch;
-    char *argv0;
+    uint32_t r = (uint32_t)row + BIAS, c = (uint32_t)col + BIAS;
+    struct tile *tile = find_tile(r / TILE, c / TILE);
+    uint64_t bit = 1ULL << (c % TILE);
 
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
+    if (tile->seen[r % TILE] & bit) {
+        return false;
+    }
+    tile->seen[r % TILE] |= bit;
+    return true;
+}
 
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
+static void
+clear_visits()
+{
+    t_tiles = 0;
+    last_tile = -1;
+    for (int i = 0; i < table_size; i++) {
+        table[i] = -1;
     }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
+}
+
+/*
+ * Where Santa and Robo-Santa are on the current line of directions
+ * (they take turns), how far they have gone each way, and how many
+ * houses they have visited. A line can run on over any number of
+ * chunks of the input.
+ */
+int row[2], col[2];
+int max_row, min_row, max_col, min_col;
+int t_seen;
+long step;
+
+static void
+start_route()
+{
+    row[0] = row[1] = col[0] = col[1] = 0;
+    max_row = min_row = max_col = min_col = 0;
+    t_seen = 1;
+    step = 0;
+    clear_visits();
+    visit(row[0], col[0]);
+}
+
+static void
+move(char dir)
+{
+    int index = step++ % 2;
+
+    switch (dir) {
+    case '^':
+        row[index]--;
+        if (row[index] < min_row) {
+            min_row = row[index];
+        }
+        break;
+    case '>':
+        col[index]++;
+        if (col[index] > max_col) {
+            max_col = col[index];
+        }
+        break;
+    case 'v':
+        row[index]++;
+        if (row[index] > max_row) {
+            max_row = row[index];
+        }
+        break;
+    case '<':
+        col[index]--;
+        if (col[index] < min_col) {
+            min_col = col[index];
         }
+        break;
     }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
+    if (visit(row[index], col[index])) {
+        t_seen++;
     }
-#endif
+}
+
+static void
+report_route()
+{
+    printf("Row range: %d - %d\n", min_row, max_row);
+    printf("Col range: %d - %d\n", min_col, max_col);
+    printf("Houses visited, once or more: %d\n", t_seen);
 }
 
 
 /*
- * Print a minimal usage blurb for the program.
+ * Go through the input a chunk at a time (there's no telling how long
+ * a line of directions is), and report on the routes of each line.
  */
 void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
+solve(struct aoc_input *in)
 {
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
+    bool pending = false;
+    char *chunk;
+    size_t len;
+
+    t_tiles = 0;
+    table_size = 0;
+    table_grow();
+    start_route();
+    while ((len = aoc_read(in, &chunk)) > 0) {
+        if (opts.debug) {
+            printf("DEBUG: Chunk of %zu bytes received\n", len);
+        }
+        for (size_t i = 0; i < len; i++) {
+            if (chunk[i] == '\n') {
+                report_route();
+                start_route();
+                pending = false;
+                continue;
+            }
+            move(chunk[i]);
+            pending = true;
+        }
     }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
+    if (pending) {
+        report_route();
+    }
+    if (opts.debug) {
+        printf("DEBUG: End of file\n");
     }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    free(tiles);
+    free(table);
+    tiles = NULL;
+    table = NULL;
+    s_tiles = 0;
 }
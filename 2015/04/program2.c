@@ -5,226 +5,320 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
+# include <limits.h>     /* LONG_MAX             */
 # include <stdbool.h>    /* bool, true, false    */
+# include <stdint.h>     /* uint32_t             */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
 # include <openssl/md5.h>
 
-# define YEAR 2015
-# define DAY     4
-# define PART    2
+# include "aoc.h"
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
+AOC_PROGRAM(2015, 4, 2);
 
-# define MAX_LEN 1024
+/* The number of leading zeros (in hex) we're after */
+# define ZEROS 6
 
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
 
+/*
+ * A small MD5 of our own, which only deals with messages that fit in a
+ * single block (which the secret key plus a counter easily do) and
+ * hashes LANES of them at once. Every step is a loop over the lanes,
+ * with the message words stored lane by lane, so the compiler can turn
+ * those into SIMD instructions (-O3, and -march=native for the widest
+ * ones the CPU has).
+ */
+# define LANES 8
+# define BLOCK 64
+/* Room for the 0x80 padding byte and the 8 byte length */
+# define MAX_MESSAGE (BLOCK - 9)
+
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+static const int md5_s[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
 
+# define ROTATE(x, s) (((x) << (s)) | ((x) >> (32 - (s))))
 
 /*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
+ * The message words for all lanes: m[word][lane]
  */
-int
-main(int argc, char *argv[], char *env[])
+typedef uint32_t md5_block[16][LANES];
+
+/*
+ * Hash one block in every lane, returning the first word of each of
+ * the digests (which is all we need to look at the leading zeros).
+ */
+static void
+md5_lanes(md5_block m, uint32_t first[LANES])
 {
-    parse_options(&argc, &argv);
+    uint32_t a[LANES], b[LANES], c[LANES], d[LANES];
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
+    for (int l = 0; l < LANES; l++) {
+        a[l] = 0x67452301;
+        b[l] = 0xefcdab89;
+        c[l] = 0x98badcfe;
+        d[l] = 0x10325476;
     }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
+    for (int i = 0; i < 64; i++) {
+        int g;
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
+        if (i < 16) {
+            g = i;
+        } else if (i < 32) {
+            g = (5 * i + 1) % 16;
+        } else if (i < 48) {
+            g = (3 * i + 5) % 16;
+        } else {
+            g = (7 * i) % 16;
         }
+        for (int l = 0; l < LANES; l++) {
+            uint32_t f;
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
+            if (i < 16) {
+                f = (b[l] & c[l]) | (~b[l] & d[l]);
+            } else if (i < 32) {
+                f = (d[l] & b[l]) | (~d[l] & c[l]);
+            } else if (i < 48) {
+                f = b[l] ^ c[l] ^ d[l];
+            } else {
+                f = c[l] ^ (b[l] | ~d[l]);
+            }
+            f += a[l] + md5_k[i] + m[g][l];
+            a[l] = d[l];
+            d[l] = c[l];
+            c[l] = b[l];
+            b[l] += ROTATE(f, md5_s[i]);
         }
-        process_file(fd);
-        fclose(fd);
+    }
+    for (int l = 0; l < LANES; l++) {
+        first[l] = a[l] + 0x67452301;
     }
 }
 
-
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * The leading zeros, as a mask on the first (little endian) word of
+ * the digest: the first nibble printed is the high one of the first
+ * byte, and so on.
  */
-void
-process_file(FILE *fd)
+static uint32_t
+zeros_mask(int zeros)
 {
-    char buf[MAX_LEN + 1];
+    uint32_t mask = 0;
 
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
+    for (int n = 0; n < zeros; n++) {
+        int shift = (n / 2) * 8 + (n % 2 == 0 ? 4 : 0);
 
-            SHA256((unsigned char *)buf, strlen(buf), digest);
+        mask |= (uint32_t)0xf << shift;
+    }
+    return mask;
+}
 
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
+/*
+ * The search state of one lane: the message (key plus counter, in
+ * decimal) and where the digits start.
+ */
+struct lane {
+    unsigned char msg[BLOCK];
+    size_t        key_len;
+    size_t        len;
+};
 
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
-        }
-        int counter = 0;
-        while (true) {
-            char str[MAX_LEN];
-            unsigned char digest[MD5_DIGEST_LENGTH];
-            char hexdigest[MD5_DIGEST_LENGTH * 2 + 1];
+/*
+ * (Re)write the counter and the padding for a lane
+ */
+static void
+lane_set(struct lane *lane, md5_block m, int l, long counter)
+{
+    char digits[32];
+    int n = snprintf(digits, sizeof(digits), "%ld", counter);
 
-            sprintf(str, "%s%d", buf, counter);
-            MD5((unsigned char *)str, strlen(str), digest);
-            for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
-            if (opts.debug) {
-                printf("%s -> %s\n", str, hexdigest);
-            }
-            if (!strncmp("000000", hexdigest, 6)) {
-                printf("Found it? %d\n", counter);
-                break;
-            }
-            counter++;
-        }
+    if (lane->key_len + n > MAX_MESSAGE) {
+        printf("Oops. The key plus counter doesn't fit in one block anymore.\n");
+        exit(1);
     }
-    if (opts.debug) {
-        printf("DEBUG: End of file\n");
+    memset(lane->msg + lane->key_len, 0, BLOCK - lane->key_len);
+    memcpy(lane->msg + lane->key_len, digits, n);
+    lane->len = lane->key_len + n;
+    lane->msg[lane->len] = 0x80;
+    uint64_t bits = (uint64_t)lane->len * 8;
+    for (int i = 0; i < 8; i++) {
+        lane->msg[56 + i] = bits >> (8 * i);
+    }
+    for (int w = 0; w < 16; w++) {
+        unsigned char *p = &lane->msg[w * 4];
+
+        m[w][l] = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
     }
 }
 
+/*
+ * Add to the counter of a lane, in place. Only the words that have
+ * changed digits get updated, unless it needs another digit, in which
+ * case it's written out again (from scratch).
+ */
+static void
+lane_add(struct lane *lane, md5_block m, int l, long counter, int add)
+{
+    size_t pos = lane->len;
+
+    while (add > 0) {
+        if (pos == lane->key_len) {
+            lane_set(lane, m, l, counter);
+            return;
+        }
+        pos--;
+        int digit = lane->msg[pos] - '0' + add;
+        lane->msg[pos] = '0' + digit % 10;
+        add = digit / 10;
+    }
+    for (size_t w = pos / 4; w * 4 < lane->len; w++) {
+        unsigned char *p = &lane->msg[w * 4];
+
+        m[w][l] = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+}
 
 /*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
+ * The counters are handed out to the threads in chunks. Once one of
+ * them finds a match, no more chunks are handed out, but the ones
+ * before it that other threads are still on have to be finished.
  */
-void
-parse_options(int *argc, char **argv[])
+# define CHUNK (LANES * 8192)
+
+struct {
+    const char *key;
+    size_t      key_len;
+    uint32_t    mask;
+    long        found;
+} search;
+
+struct searcher {
+    struct lane lanes[LANES];
+    md5_block   m;
+    long        found;
+};
+
+static void *
+searcher_init()
+{
+    struct searcher *s = malloc(sizeof(struct searcher));
+
+    if (s == NULL) {
+        printf("Oops. Failed to allocate a searcher.\n");
+        exit(1);
+    }
+    for (int l = 0; l < LANES; l++) {
+        memcpy(s->lanes[l].msg, search.key, search.key_len);
+        s->lanes[l].key_len = search.key_len;
+    }
+    s->found = -1;
+    return s;
+}
+
+static bool
+search_chunk(void *scratch, long start, long end)
 {
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
-    }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
+    struct searcher *s = scratch;
+    uint32_t first[LANES];
+
+    for (int l = 0; l < LANES; l++) {
+        lane_set(&s->lanes[l], s->m, l, start + l);
+    }
+    for (long counter = start; counter < end; counter += LANES) {
+        if (counter > start) {
+            for (int l = 0; l < LANES; l++) {
+                lane_add(&s->lanes[l], s->m, l, counter + l, LANES);
+            }
+        }
+        md5_lanes(s->m, first);
+        for (int l = 0; l < LANES; l++) {
+            if ((first[l] & search.mask) == 0) {
+                /* Later lanes (and counters) can only be bigger */
+                s->found = counter + l;
+                return false;
+            }
         }
     }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
+    return true;
+}
+
+static void
+searcher_reduce(void *scratch)
+{
+    struct searcher *s = scratch;
+
+    if (s->found >= 0 && (search.found < 0 || s->found < search.found)) {
+        search.found = s->found;
     }
-#endif
 }
 
+static long
+find_counter(const char *key, size_t key_len, int zeros)
+{
+    if (key_len + 1 > MAX_MESSAGE) {
+        printf("Oops. The key is too long for this search.\n");
+        exit(1);
+    }
+    search.key = key;
+    search.key_len = key_len;
+    search.mask = zeros_mask(zeros);
+    search.found = -1;
+    if (opts.verbose) {
+        printf("Searching with %d threads, %d lanes each.\n", aoc_threads(), LANES);
+    }
+    aoc_parallel_for(LONG_MAX, CHUNK, searcher_init, search_chunk, searcher_reduce, free);
+    return search.found;
+}
 
 /*
- * Print a minimal usage blurb for the program.
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
+solve(struct aoc_input *in)
 {
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
+
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        if (in->lines[lineno].len == 0) {
+            continue;
+        }
+        long counter = find_counter(buf, in->lines[lineno].len, ZEROS);
+        if (opts.debug) {
+            /* Double check with the real thing */
+            char str[BLOCK];
+            unsigned char digest[MD5_DIGEST_LENGTH];
+
+            snprintf(str, sizeof(str), "%s%ld", buf, counter);
+            MD5((unsigned char *)str, strlen(str), digest);
+            printf("%s ->", str);
+            for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
+                printf(" %02x", (unsigned int)digest[i]);
+            }
+            printf("\n");
+        }
+        printf("Found it? %ld\n", counter);
+    }
+    if (opts.debug) {
+        printf("DEBUG: End of file\n");
+    }
 }
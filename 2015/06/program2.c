@@ -5,268 +5,268 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
-# include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
+# include <string.h>     /* memset()             */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2015
-# define DAY     6
-# define PART    2
+AOC_PROGRAM(2015, 6, 2);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
 
-# define MAX_LEN 1024
+enum action {
+    TURN_ON,
+    TURN_OFF,
+    TOGGLE
+};
 
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
+/*
+ * The instructions, with the rectangle both as it was given (inclusive)
+ * and in compressed coordinates (exclusive at the end), see below.
+ */
+struct instruction {
+    enum action action;
+    int         row_min, col_min, row_max, col_max;
+    int         from_row, from_col, to_row, to_col;
+} *instructions = NULL;
+int t_instructions;
 
+/*
+ * Only the rows and columns where a rectangle starts, or just ended,
+ * matter: all the lights between two of those breakpoints go through
+ * exactly the same. So the grid is cut into bands of rows, and every
+ * band into blocks of columns, and each block is treated as a single
+ * light that counts for as many as it covers.
+ */
+int *rows = NULL, *cols = NULL;
+int t_rows, t_cols;
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+static int
+compare_ints(const void *i1, const void *i2)
+{
+    int a = *(const int *)i1, b = *(const int *)i2;
 
+    return a < b ? -1 : a > b;
+}
 
 /*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
+ * Sort the breakpoints, dropping the doubles, and return how many are
+ * left.
  */
-int
-main(int argc, char *argv[], char *env[])
+static int
+unique_breakpoints(int *points, int total)
 {
-    parse_options(&argc, &argv);
-
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
-    }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
-
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+    int unique = 0;
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
+    qsort(points, total, sizeof(int), compare_ints);
+    for (int i = 0; i < total; i++) {
+        if (unique == 0 || points[i] != points[unique - 1]) {
+            points[unique++] = points[i];
         }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
-        }
-        process_file(fd);
-        fclose(fd);
     }
+    return unique;
 }
 
-
-int grid[1000][1000];
-
-void
-grid_init()
+static int
+breakpoint(int *points, int total, int value)
 {
-    for (int i = 0; i < 1000; i++) {
-        for (int j = 0; j < 1000; j++) {
-            grid[i][j] = 0;
-        }
-    }
-}
+    int *found = bsearch(&value, points, total, sizeof(int), compare_ints);
 
-void
-set_value(int row_min, int col_min, int row_max, int col_max, bool val)
-{
-    for (int row = row_min; row <= row_max; row++) {
-        for (int col = col_min; col <= col_max; col++) {
-            if (val) {
-                grid[row][col]++;
-            } else if (grid[row][col]) {
-                grid[row][col]--;
-            }
-        }
+    if (found == NULL) {
+        printf("Oops. Lost track of breakpoint %d.\n", value);
+        exit(1);
     }
+    return found - points;
 }
 
-void
-toggle_value(int row_min, int col_min, int row_max, int col_max)
+static void
+compress_grid()
 {
-    for (int row = row_min; row <= row_max; row++) {
-        for (int col = col_min; col <= col_max; col++) {
-            grid[row][col] += 2;
-        }
+    rows = malloc((2 * t_instructions + 1) * sizeof(int));
+    cols = malloc((2 * t_instructions + 1) * sizeof(int));
+    if (rows == NULL || cols == NULL) {
+        printf("Oops. Failed to allocate the breakpoints.\n");
+        exit(1);
+    }
+    for (int i = 0; i < t_instructions; i++) {
+        rows[2 * i]     = instructions[i].row_min;
+        rows[2 * i + 1] = instructions[i].row_max + 1;
+        cols[2 * i]     = instructions[i].col_min;
+        cols[2 * i + 1] = instructions[i].col_max + 1;
+    }
+    t_rows = unique_breakpoints(rows, 2 * t_instructions);
+    t_cols = unique_breakpoints(cols, 2 * t_instructions);
+    for (int i = 0; i < t_instructions; i++) {
+        struct instruction *ins = &instructions[i];
+
+        ins->from_row = breakpoint(rows, t_rows, ins->row_min);
+        ins->to_row   = breakpoint(rows, t_rows, ins->row_max + 1);
+        ins->from_col = breakpoint(cols, t_cols, ins->col_min);
+        ins->to_col   = breakpoint(cols, t_cols, ins->col_max + 1);
     }
 }
 
-int
-count_grid()
+/*
+ * The blocks of a band each have a brightness, which can't go below 0.
+ * The loops are kept free of branches, so the compiler can do several
+ * blocks at a time in vector registers.
+ */
+static void
+apply_brightness(int *bright, int from, int to, enum action action)
 {
-    int total = 0;
-
-    for (int row = 0; row < 1000; row++) {
-        for (int col = 0; col < 1000; col++) {
-            total += grid[row][col];
+    switch (action) {
+    case TURN_ON:
+        for (int col = from; col < to; col++) {
+            bright[col]++;
         }
+        break;
+    case TURN_OFF:
+        for (int col = from; col < to; col++) {
+            bright[col] = bright[col] > 0 ? bright[col] - 1 : 0;
+        }
+        break;
+    case TOGGLE:
+        for (int col = from; col < to; col++) {
+            bright[col] += 2;
+        }
+        break;
     }
-    return total;
 }
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * Run all the instructions that cover a band, and add up the brightness
+ * of the lights in it.
  */
-void
-process_file(FILE *fd)
+static long
+light_band(int band, int *bright)
 {
-    char buf[MAX_LEN + 1];
-
-    grid_init();
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
-
-            SHA256((unsigned char *)buf, strlen(buf), digest);
+    long total = 0;
 
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
+    memset(bright, 0, t_cols * sizeof(int));
+    for (int i = 0; i < t_instructions; i++) {
+        struct instruction *ins = &instructions[i];
 
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
-        }
-        int row_min, row_max, col_min, col_max;
-
-        if (sscanf(buf, "toggle %d,%d through %d,%d",
-                   &row_min, &col_min, &row_max, &col_max)) {
-            toggle_value(row_min, col_min, row_max, col_max);
-        } else if (sscanf(buf, "turn on %d,%d through %d,%d",
-                          &row_min, &col_min, &row_max, &col_max)) {
-            set_value(row_min, col_min, row_max, col_max, true);
-        } else if (sscanf(buf, "turn off %d,%d through %d,%d",
-                          &row_min, &col_min, &row_max, &col_max)) {
-            set_value(row_min, col_min, row_max, col_max, false);
+        if (ins->from_row <= band && band < ins->to_row) {
+            apply_brightness(bright, ins->from_col, ins->to_col, ins->action);
         }
     }
-    if (opts.debug) {
-        printf("DEBUG: End of file\n");
+    for (int col = 0; col < t_cols - 1; col++) {
+        total += (long)bright[col] * (cols[col + 1] - cols[col]);
     }
-    printf("Sum of the brightness of all lights: %d\n", count_grid());
+    return total * (rows[band + 1] - rows[band]);
 }
 
+/* The number of bands a thread takes at a time */
+# define CHUNK 8
 
 /*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
+ * What a thread needs to light its bands, and what it found in them.
  */
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
+struct band {
+    int  *bright;
+    long  brightness;
+};
 
-    argv0 = (*argv)[0];
+long brightness;
 
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
+static void *
+band_init()
+{
+    struct band *b = malloc(sizeof(struct band));
 
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
+    if (b != NULL) {
+        b->bright = malloc((t_cols + 1) * sizeof(int));
+        b->brightness = 0;
     }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
+    if (b == NULL || b->bright == NULL) {
+        printf("Oops. Failed to allocate a band.\n");
+        exit(1);
     }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
+    return b;
+}
+
+static bool
+light_bands(void *scratch, long from, long to)
+{
+    struct band *b = scratch;
+
+    for (long band = from; band < to; band++) {
+        b->brightness += light_band(band, b->bright);
     }
-#endif
+    return true;
 }
 
+static void
+band_reduce(void *scratch)
+{
+    brightness += ((struct band *)scratch)->brightness;
+}
+
+static void
+band_fini(void *scratch)
+{
+    free(((struct band *)scratch)->bright);
+    free(scratch);
+}
 
 /*
- * Print a minimal usage blurb for the program.
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
+solve(struct aoc_input *in)
 {
-    char *name;
+    instructions = malloc((in->count + 1) * sizeof(struct instruction));
+    if (instructions == NULL) {
+        printf("Oops. Failed to allocate the instructions.\n");
+        exit(1);
+    }
+    t_instructions = 0;
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
+
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        if (!in->lines[lineno].len) {
+            continue;
+        }
+        struct instruction *ins = &instructions[t_instructions];
 
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
+        if (sscanf(buf, "toggle %d,%d through %d,%d",
+                   &ins->row_min, &ins->col_min, &ins->row_max, &ins->col_max) == 4) {
+            ins->action = TOGGLE;
+        } else if (sscanf(buf, "turn on %d,%d through %d,%d",
+                          &ins->row_min, &ins->col_min, &ins->row_max, &ins->col_max) == 4) {
+            ins->action = TURN_ON;
+        } else if (sscanf(buf, "turn off %d,%d through %d,%d",
+                          &ins->row_min, &ins->col_min, &ins->row_max, &ins->col_max) == 4) {
+            ins->action = TURN_OFF;
+        } else {
+            printf("Oops. Can't make sense of '%s'.\n", buf);
+            exit(1);
+        }
+        if (ins->row_min > ins->row_max || ins->col_min > ins->col_max) {
+            printf("Oops. The rectangle of '%s' is inside out.\n", buf);
+            exit(1);
+        }
+        t_instructions++;
+    }
+    if (opts.debug) {
+        printf("DEBUG: End of file\n");
     }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
+    compress_grid();
+    if (opts.verbose) {
+        printf("Going through %d bands of %d blocks with %d threads.\n",
+               t_rows - 1, t_cols - 1, aoc_threads());
     }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    brightness = 0;
+    aoc_parallel_for(t_rows - 1, CHUNK, band_init, light_bands, band_reduce, band_fini);
+    printf("Sum of the brightness of all lights: %ld\n", brightness);
+    free(instructions);
+    free(rows);
+    free(cols);
+    instructions = NULL;
+    rows = cols = NULL;
 }
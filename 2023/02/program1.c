@@ -5,24 +5,17 @@
  * =======================================================================
  */
 
-# include <libgen.h>  /* basename()           */
 # include <stdbool.h> /* bool, true, false    */
 # include <stdio.h>   /* FILE, *printf(), etc */
 # include <stdlib.h>  /* exit()               */
 # include <string.h>  /* strlen()             */
-# include <unistd.h>  /* getopt()             */
 
-# define MAX_LEN 1024
+# include "aoc.h"
 
-struct {
-    bool debug;
-    bool dryrun;
-    bool verbose;
-} opts;
+# define MAX_LEN 1024
 
+AOC_PROGRAM(2023, 02, 1);
 
-void parse_options(int argc, char *argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
 
 bool
 is_possible(char *info, int len)
@@ -76,23 +69,17 @@ is_possible(char *info, int len)
     return true;
 }
 
-int
-main(int argc, char *argv[], char *env[])
+void
+solve(struct aoc_input *in)
 {
     int sum_ids = 0;
-    char buf[MAX_LEN + 1];
-
-    parse_options(argc, argv);
 
-    while (NULL != fgets(buf, MAX_LEN, stdin)) {
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
         char *info;
         int game_id;
         int game_possible = true;
 
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
         if (opts.debug) {
             printf("DEBUG: Line received: '%s'\n", buf);
         }
@@ -119,7 +106,7 @@ main(int argc, char *argv[], char *env[])
                 printf("  Snippet: %.*s\n", (int)(ix - info), info);
             }
 
-            strlcpy(snippet, info, 1 + (int)(ix - info));
+            snprintf(snippet, 1 + (int)(ix - info), "%s", info);
             game_possible = is_possible(snippet, strlen(snippet));
             if (!game_possible) {
                 break;
@@ -139,82 +126,3 @@ main(int argc, char *argv[], char *env[])
     }
     printf("Sum of the IDs of possible games is %d\n", sum_ids);
 }
-
-
-void
-parse_options(int argc, char *argv[])
-{
-    int ch;
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (argc == 1) {
-        /* What to do if there are no command line arguments */
-        return;
-    }
-    while ((ch = getopt(argc, argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, argv[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, argv[0], "\n", false, EXIT_FAILURE);
-        }
-    }
-    argc -= optind;
-    if (argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv[0], "Too many parameters provided.\n\n", false, EXIT_FAILURE);
-    }
-    argv += optind;
-}
-
-
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC 2023 puzzles; Day 2, part 1\n\
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC 2023 puzzles; Day 2, part 1.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
-}
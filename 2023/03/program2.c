@@ -5,29 +5,21 @@
  * =======================================================================
  */
 
-# include <libgen.h>  /* basename()           */
 # include <stdbool.h> /* bool, true, false    */
 # include <stdio.h>   /* FILE, *printf(), etc */
 # include <stdlib.h>  /* exit()               */
 # include <string.h>  /* strlen()             */
-# include <unistd.h>  /* getopt()             */
 # include <ctype.h>   /* isdigit()            */
 
-# define MAX_LEN 1024
+# include "aoc.h"
 
-struct {
-    bool debug;
-    bool dryrun;
-    bool verbose;
-} opts;
+AOC_PROGRAM(2023, 03, 2);
 
 int *star_totals;
 int *star_touching;
 int max_rows;
 int max_cols;
 
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
 
 /* Check if a position has a star, and if so, track how many values
    are near it, and the product of their values */
@@ -78,33 +70,27 @@ check_all_stars(char **map, int row, int col)
     }
 }
 
-int
-main(int argc, char *argv[], char *env[])
+void
+solve(struct aoc_input *in)
 {
     char **map;
-    char buf[MAX_LEN + 1];
     int rows = 0;
     int cols = 0;
-    parse_options(&argc, &argv);
-    map = (char **)calloc(141, sizeof(char *));
-    while (NULL != fgets(buf, MAX_LEN, stdin)) {
+    map = (char **)calloc(in->count + 1, sizeof(char *));
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
+
         rows++;
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
         if (opts.debug) {
             printf("DEBUG: Line received: '%s'\n", buf);
         }
-        if (strlen(buf) > cols) {
-            cols = strlen(buf);
+        if (in->lines[lineno].len > cols) {
+            cols = in->lines[lineno].len;
         }
-        map[rows - 1] = (char *)malloc(strlen(buf) + 1);
-        strcpy(map[rows - 1], buf);
+        map[rows - 1] = buf;
     }
     /* add an empty line, for the check_star() test */
-    map[rows] = (char *)malloc(1);
-    map[rows][0] = '\0';
+    map[rows] = "";
     max_rows = rows;
     max_cols = cols;
     
@@ -145,89 +131,7 @@ main(int argc, char *argv[], char *env[])
     printf("Total gear ratios is %d\n", gear_ratios);
 
     /* For valgrind ;) */
-    for (int i = 0; i <= rows; i++) {
-        free(map[i]);
-    }
     free(map);
     free(star_totals);
     free(star_touching);
 }
-
-
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        return;
-    }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
-    }
-    *argc -= optind;
-    *argv += optind;
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, (*argv)[0], "Too many parameters provided.\n\n", false, EXIT_FAILURE);
-    }
-}
-
-
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC 2023 puzzles; Day 3, part 2\n\
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC 2023 puzzles; Day 3, part 2.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
-}
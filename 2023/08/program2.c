@@ -5,107 +5,337 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# define MAX_LEN 1024
+# include "aoc.h"
 
-struct {
-    bool debug;
-    bool dryrun;
-    bool verbose;
-} opts;
+AOC_PROGRAM(2023, 08, 2);
 
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+/*
+ * The answer can be the product of a lot of cycles, so the combining
+ * is done in 128 bits.
+ */
+typedef __int128 big;
+
+char *lr;
+size_t lr_len;
+
+struct node {
+    char *n;
+    char *l;
+    int   l_i;
+    char *r;
+    int   r_i;
+    bool  z;
+} *nodes = NULL;
+int total = 0;
+
+/*
+ * The node names, interned in an open addressing table
+ */
+int *names = NULL;
+int names_size;
+
+int
+name_slot(const char *name)
+{
+    unsigned int hash = 2166136261u;
 
+    for (const char *p = name; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    int slot = hash & (names_size - 1);
+    while (names[slot] != -1 && strcmp(nodes[names[slot]].n, name)) {
+        slot = (slot + 1) & (names_size - 1);
+    }
+    return slot;
+}
 
 int
-main(int argc, char *argv[], char *env[])
+find_node(char *name)
 {
-    parse_options(&argc, &argv);
+    int i = names[name_slot(name)];
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
+    if (i == -1) {
+        printf("Something went wrong? We looked for %s but could not find it.\n", name);
+        exit(1);
     }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
+    return i;
+}
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+/*
+ * A ghost's state is the node it's on, and where it is in the
+ * instructions. There's a finite number of those, so eventually it
+ * ends up in a cycle.
+ */
+static inline long
+next_state(long state)
+{
+    int node = state / lr_len;
+    size_t index = state % lr_len;
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
+    node = lr[index] == 'L' ? nodes[node].l_i : nodes[node].r_i;
+    return (long)node * lr_len + (index + 1) % lr_len;
+}
+
+/*
+ * What we know about where a ghost goes: after mu steps it has entered
+ * a cycle of lambda steps, and it's on a **Z node at the steps in hits
+ * (all before mu + lambda).
+ */
+struct ghost {
+    int   start;
+    long  mu;
+    long  lambda;
+    long *hits;
+    int   h_total;
+};
+
+/*
+ * Brent's cycle detection, which doesn't need to remember the states
+ * it has seen, followed by a walk to the end of the first cycle to
+ * note the **Z nodes.
+ */
+void
+analyze_ghost(struct ghost *g)
+{
+    long start = (long)g->start * lr_len;
+    long power = 1, lambda = 1;
+    long tortoise = start, hare = next_state(start);
+
+    while (tortoise != hare) {
+        if (power == lambda) {
+            tortoise = hare;
+            power *= 2;
+            lambda = 0;
         }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
+        hare = next_state(hare);
+        lambda++;
+    }
+    long mu = 0;
+    tortoise = hare = start;
+    for (long i = 0; i < lambda; i++) {
+        hare = next_state(hare);
+    }
+    while (tortoise != hare) {
+        tortoise = next_state(tortoise);
+        hare = next_state(hare);
+        mu++;
+    }
+    g->mu = mu;
+    g->lambda = lambda;
+
+    int size = 16;
+    g->hits = malloc(size * sizeof(long));
+    if (g->hits == NULL) {
+        printf("Oops. Failed to allocate the hits.\n");
+        exit(1);
+    }
+    g->h_total = 0;
+    long state = start;
+    for (long step = 0; step < mu + lambda; step++) {
+        if (nodes[state / lr_len].z) {
+            if (g->h_total == size) {
+                long *hits = realloc(g->hits, size * 2 * sizeof(long));
+
+                if (hits == NULL) {
+                    printf("Oops. Failed to grow the hits to %d.\n", size * 2);
+                    exit(1);
+                }
+                g->hits = hits;
+                size *= 2;
+            }
+            g->hits[g->h_total++] = step;
         }
-        process_file(fd);
-        fclose(fd);
+        state = next_state(state);
+    }
+    if (opts.debug || opts.verbose) {
+        printf("Ghost from %s enters a cycle of %ld after %ld steps, and hits %d **Z nodes.\n",
+               nodes[g->start].n, lambda, mu, g->h_total);
     }
 }
 
+/*
+ * Solve x = a1 (mod m1), x = a2 (mod m2), for moduli that don't have
+ * to be coprime. Returns false if there is no solution, otherwise the
+ * solution is x = *a (mod *m).
+ */
+bool
+crt(big a1, big m1, big a2, big m2, big *a, big *m)
+{
+    /* Extended Euclid for m1 * p + m2 * q = g */
+    big old_r = m1, r = m2, old_p = 1, p = 0;
+
+    while (r != 0) {
+        big q = old_r / r, t;
+
+        t = old_r - q * r; old_r = r; r = t;
+        t = old_p - q * p; old_p = p; p = t;
+    }
+    big g = old_r;
+    if ((a2 - a1) % g != 0) {
+        return false;
+    }
+    big lcm = m1 / g * m2;
+    big k = ((a2 - a1) / g) % (m2 / g) * (old_p % (m2 / g)) % (m2 / g);
+    *a = ((a1 + m1 * k) % lcm + lcm) % lcm;
+    *m = lcm;
+    return true;
+}
 
 void
-process_file(FILE *fd)
+print_big(big value)
+{
+    char digits[64];
+    int len = 0;
+
+    do {
+        digits[len++] = '0' + (int)(value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (len > 0) {
+        putchar(digits[--len]);
+    }
+}
+
+/*
+ * Past the longest lead-in (mu) of all ghosts, every ghost is on a
+ * **Z node exactly at the steps matching one of its hits in the cycle,
+ * modulo the cycle length. Combine those for all the ghosts, and find
+ * the first step (from there) that satisfies all of them. The number
+ * of combinations is the product of the hits per cycle, which is just
+ * one for each ghost in the actual inputs.
+ */
+# define MAX_COMBINATIONS 1000000
+
+big
+combine_cycles(struct ghost *ghosts, int g_total, long from)
 {
-    char buf[MAX_LEN + 1];
-    char lr[300];
+    big *residues = malloc(sizeof(big));
+    big modulus = 1;
+    int r_total = 1;
+
+    if (residues == NULL) {
+        printf("Oops. Failed to allocate the residues.\n");
+        exit(1);
+    }
+    residues[0] = 0;
+    for (int i = 0; i < g_total; i++) {
+        struct ghost *g = &ghosts[i];
+        int in_cycle = 0;
+
+        for (int h = 0; h < g->h_total; h++) {
+            in_cycle += g->hits[h] >= g->mu;
+        }
+        if ((long)r_total * in_cycle > MAX_COMBINATIONS) {
+            printf("Oops. Too many combinations of cycle positions to go through.\n");
+            exit(1);
+        }
+        big *next = malloc(((size_t)r_total * in_cycle + 1) * sizeof(big));
+        if (next == NULL) {
+            printf("Oops. Failed to allocate the residues.\n");
+            exit(1);
+        }
+        int n_total = 0;
+        big next_modulus = modulus;
+        for (int r = 0; r < r_total; r++) {
+            for (int h = 0; h < g->h_total; h++) {
+                big a, m;
+
+                if (g->hits[h] < g->mu) {
+                    continue;
+                }
+                if (crt(residues[r], modulus, g->hits[h] % g->lambda, g->lambda, &a, &m)) {
+                    next[n_total++] = a;
+                    next_modulus = m;
+                }
+            }
+        }
+        free(residues);
+        residues = next;
+        r_total = n_total;
+        modulus = next_modulus;
+        if (r_total == 0) {
+            break;
+        }
+    }
+
+    big best = -1;
+    for (int r = 0; r < r_total; r++) {
+        big step = residues[r];
+
+        if (step < from) {
+            step += (from - step + modulus - 1) / modulus * modulus;
+        }
+        if (best < 0 || step < best) {
+            best = step;
+        }
+    }
+    free(residues);
+    return best;
+}
 
-    struct node {
-        char n[4];
-        char l[4];
-        int  l_i;
-        char r[4];
-        int  r_i;
-    } nodes[800];
+void
+solve(struct aoc_input *in)
+{
+    if (in->count < 2) {
+        printf("Expected the instructions and an empty line, got %zu lines.\n", in->count);
+        return;
+    }
 
     /* get the first line with left-right directions */
-    fgets(lr, MAX_LEN, fd);
-    if (lr[strlen(lr) - 1] == '\n') {
-        lr[strlen(lr) - 1] = '\0';
+    lr = in->lines[0].str;
+    lr_len = in->lines[0].len;
+    if (lr_len == 0) {
+        printf("Oops. No instructions found.\n");
+        exit(1);
     }
 
     if (opts.debug) {
         printf("Left/right instructions: %s\n", lr);
     }
 
-    /* skip the empty line */
-    fgets(buf, MAX_LEN, fd);
+    nodes = malloc(in->count * sizeof(struct node));
+    for (names_size = 1024; names_size < in->count * 2; names_size *= 2) {
+        /* Just finding the size */
+    }
+    names = malloc(names_size * sizeof(int));
+    if (nodes == NULL || names == NULL) {
+        printf("Oops. Failed to allocate the nodes.\n");
+        exit(1);
+    }
+    for (int i = 0; i < names_size; i++) {
+        names[i] = -1;
+    }
+
+    /* skip the empty line, and read the node connections: AAA = (BBB, CCC) */
+    total = 0;
+    for (size_t lineno = 2; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
 
-    /* read the node connections */
-    int total = 0;
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
         if (opts.debug) {
             printf("DEBUG: Line received: '%s'\n", buf);
         }
-        sscanf(buf, "%[A-Z0-9] = (%[A-Z0-9], %[A-Z0-9])", nodes[total].n, nodes[total].l, nodes[total].r);
-        nodes[total].l_i = -1;
-        nodes[total].r_i = -1;
+        if (!in->lines[lineno].len) {
+            continue;
+        }
+        char *eq = strstr(buf, " = (");
+        char *comma = eq ? strstr(eq, ", ") : NULL;
+        char *close = comma ? strchr(comma, ')') : NULL;
+        if (close == NULL) {
+            printf("Oops. Can't make sense of node '%s'.\n", buf);
+            exit(1);
+        }
+        *eq = *comma = *close = '\0';
+        nodes[total].n = buf;
+        nodes[total].l = eq + 4;
+        nodes[total].r = comma + 2;
+        nodes[total].z = eq[-1] == 'Z';
+        names[name_slot(buf)] = total;
         if (opts.debug) {
             printf("Node %s points to %s and %s\n", nodes[total].n, nodes[total].l, nodes[total].r);
         }
@@ -113,253 +343,76 @@ process_file(FILE *fd)
     }
     if (opts.debug) {
         printf("Parsed %d nodes total.\n", total);
-    }
-    if (opts.debug) {
         printf("DEBUG: End of file\n");
     }
 
-    /* Resolve the l_i and r_i values, to speed things up? */
-    for (int i = 0; i < total; i++) {
-        for (int j = 0; j < total; j++) {
-            if (!strcmp(nodes[i].n, nodes[j].l)) {
-                nodes[j].l_i = i;
-            }
-            if (!strcmp(nodes[i].n, nodes[j].r)) {
-                nodes[j].r_i = i;
-            }
-        }
+    struct ghost *ghosts = malloc((total + 1) * sizeof(struct ghost));
+    int g_total = 0;
+    if (ghosts == NULL) {
+        printf("Oops. Failed to allocate the ghosts.\n");
+        exit(1);
     }
-    int current_node = 0;
-    int lr_index = 0;
-    long steps = 0;
-
-    struct a_node {
-        int i;
-        int f;
-        int s;
-    } a_nodes[10];
-    int a_total = 0;
     for (int i = 0; i < total; i++) {
-        if (nodes[i].n[2] == 'A') {
-            a_nodes[a_total].i = i;
-            a_nodes[a_total].f = -1;
-            a_nodes[a_total].s = -1;
-            a_total++;
+        nodes[i].l_i = find_node(nodes[i].l);
+        nodes[i].r_i = find_node(nodes[i].r);
+        if (nodes[i].n[strlen(nodes[i].n) - 1] == 'A') {
+            ghosts[g_total++].start = i;
             if (opts.debug) {
-                printf("Found A node #%d at %d: %s\n", a_total, i, nodes[i].n);
+                printf("Found A node #%d at %d: %s\n", g_total, i, nodes[i].n);
             }
         }
     }
+    if (g_total == 0) {
+        printf("Oops. No **A nodes to start from.\n");
+        exit(1);
+    }
 
-    int a_nodes_done = 0;
-
-    while (true) {
-        bool all_on_z = true;
-        for (int i = 0; i < a_total; i++) {
-            if (nodes[a_nodes[i].i].n[2] == 'Z') {
-                if (opts.debug) {
-                    printf("A node %d is on %s after %ld steps\n", i, nodes[a_nodes[i].i].n, steps);
-                }
-                if (a_nodes[i].f == -1) {
-                    a_nodes[i].f = steps;
-                } else if (a_nodes[i].s == -1) {
-                    a_nodes[i].s = steps;
-                } else {
-                    a_nodes_done++;
-                }
-            } else {
-                all_on_z = false;
-            }
-        }
-        /*
-         * Checking for all_on_z really only works for the sample
-         * file. Based on an observation of debug output at an earlier
-         * stage, we know that the various nodes ending in A keep
-         * landing on the same nodes ending in Z, over and over, so we
-         * need to know how long their cycles are, and keep going
-         * until they've all been there twice.
-         */
-        if (all_on_z || a_nodes_done == a_total) {
-            break;
-        }
-
-        if (opts.debug) {
-            printf("Going %c next\n", lr[lr_index]);
-        }
-        /* move all nodes along */
-        for (int i = 0; i < a_total; i++) {
-            char *node_to_find;
-            int next_node;
-
-            int current_node = a_nodes[i].i;
-            if (lr[lr_index] == 'L') {
-                node_to_find = nodes[current_node].l;
-                next_node    = nodes[current_node].l_i;
-            } else {
-                node_to_find = nodes[current_node].r;
-                next_node    = nodes[current_node].r_i;
-            }
-            if (opts.debug) {
-                printf("Next node: %s (%d)\n", node_to_find, next_node);
-            }
-            if (next_node == -1) {
-                printf("Something went wrong? We looked for %s but could not find it.\n",
-                       node_to_find);
-                exit(1);
-            }
-            if (opts.debug) {
-                printf("Index of %s is %d\n", node_to_find, next_node);
-            }
-            a_nodes[i].i = next_node;
-        }
-        steps++;
-        lr_index = (lr_index + 1) % strlen(lr);
-        if (opts.debug && steps % 1000 == 0) {
-            printf("Steps so far: %ld\n", steps);
+    long from = 0;
+    for (int i = 0; i < g_total; i++) {
+        analyze_ghost(&ghosts[i]);
+        if (ghosts[i].mu > from) {
+            from = ghosts[i].mu;
         }
     }
 
     /*
-     * Now, knowing the cycle, we can take much bigger steps and don't
-     * need to move around the real nodes any longer.
-     *
-     * This is still overly generic. In the actual input I was given,
-     * two things were later apparent:
-     *
-     * 1. Each of the A nodes took as many steps to reach the Z node
-     *    the first time, as the second time, so we could actually
-     *    simplify this particular case with a least common multiple
-     *    of the 6 numbers.
-     * 2. All 6 of the A nodes have a cycle that is a multiple of 277.
-     *
-     * So the answer to the question is then:
-     *
-     * >>> 277 * (16343 / 277) * (11911 / 277) * (20221 / 277) *
-     *     (21883 / 277) * (13019 / 277) * (19667 / 277)
-     * 13524038372771
+     * Before all of them are in their cycle, just walk along with them
+     * (the lead-ins are short, in practice).
      */
-    struct a_step {
-        long steps;
-        long incr;
-    } a_steps[10];
-    for (int i = 0; i < a_total; i++) {
-        if (opts.debug) {
-            printf("A node arrived at Z nodes %d first, %d second (cycle is %d).\n",
-                   a_nodes[i].f,
-                   a_nodes[i].s,
-                   a_nodes[i].s - a_nodes[i].f);
-        }
-        a_steps[i].steps = a_nodes[i].f;
-        a_steps[i].incr = a_nodes[i].s - a_nodes[i].f;
+    big answer = -1;
+    long states[g_total];
+    for (int i = 0; i < g_total; i++) {
+        states[i] = (long)ghosts[i].start * lr_len;
     }
-    while (true) {
-        bool done = true;
+    for (long step = 0; step < from && answer < 0; step++) {
+        bool all_on_z = true;
 
-        long steps = a_steps[0].steps;
-        long max_steps = a_steps[0].steps;
-        for (int i = 1; i < a_total; i++) {
-            if (a_steps[i].steps != steps) {
-                done = false;
-            }
-            if (a_steps[i].steps > max_steps) {
-                max_steps = a_steps[i].steps;
+        for (int i = 0; i < g_total; i++) {
+            if (!nodes[states[i] / lr_len].z) {
+                all_on_z = false;
             }
+            states[i] = next_state(states[i]);
         }
-        if (done) {
-            printf("Reached all **Z nodes after %ld steps.\n", steps);
-            exit(0);
-        }
-        for (int i = 0; i < a_total; i++) {
-            if (a_steps[i].steps < max_steps) {
-                a_steps[i].steps += a_steps[i].incr;
-            }
+        if (all_on_z) {
+            answer = step;
         }
     }
-}
-
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
+    if (answer < 0) {
+        answer = combine_cycles(ghosts, g_total, from);
     }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
+    if (answer < 0) {
+        printf("The ghosts never all reach **Z nodes at the same time.\n");
+    } else {
+        printf("Reached all **Z nodes after ");
+        print_big(answer);
+        printf(" steps.\n");
     }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
+    for (int i = 0; i < g_total; i++) {
+        free(ghosts[i].hits);
     }
-#endif
-}
-
-
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC 2023 puzzles; Day 8, part 2\n\
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC 2023 puzzles; Day 8, part 2.\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    free(ghosts);
+    free(nodes);
+    free(names);
+    nodes = NULL;
+    names = NULL;
 }
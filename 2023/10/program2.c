@@ -5,87 +5,80 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
+# include <stdint.h>     /* uint64_t             */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# define MAX_LEN 1024
+# include "aoc.h"
 
-struct {
-    bool debug;
-    bool dryrun;
-    bool verbose;
-} opts;
+AOC_PROGRAM(2023, 10, 2);
 
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+/*
+ * The map rows point into the input, and the pipes that are part of
+ * the loop are marked in a bitmap of the same size.
+ */
+char **pipes = NULL;
+uint64_t *on_loop = NULL;
+int max_row, max_col;
+
+static inline void
+mark_loop(int row, int col)
+{
+    size_t i = (size_t)row * max_col + col;
 
+    on_loop[i / 64] |= 1ULL << (i % 64);
+}
 
-int
-main(int argc, char *argv[], char *env[])
+static inline bool
+is_loop(int row, int col)
 {
-    parse_options(&argc, &argv);
+    size_t i = (size_t)row * max_col + col;
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
-    }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
+    return (on_loop[i / 64] >> (i % 64)) & 1;
+}
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+/*
+ * Going along a row from the left, every pipe of the loop that goes
+ * up (|, L or J) crosses from outside to inside, or back again. Pairs
+ * like L-7 count once that way, and F-J too, while L-J and F-7 (that
+ * turn back the way they came) count twice or not at all. So one pass
+ * over each row is enough to tell the ground inside the loop.
+ */
+long
+count_enclosed()
+{
+    long ground = 0;
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
+    for (int row = 0; row < max_row; row++) {
+        bool inside = false;
+
+        for (int col = 0; col < max_col; col++) {
+            if (is_loop(row, col)) {
+                char c = pipes[row][col];
+
+                if (c == '|' || c == 'L' || c == 'J') {
+                    inside = !inside;
+                }
+                if (opts.debug) {
+                    putchar('+');
+                }
+                continue;
+            }
+            if (inside) {
+                ground++;
+            }
+            if (opts.debug) {
+                putchar(inside ? '.' : '+');
+            }
         }
         if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
+            putchar('\n');
         }
-        process_file(fd);
-        fclose(fd);
-    }
-}
-
-char pipes_copy[150][150];
-char pipes[150][150];
-char plotter[300][300];
-
-void
-flood_fill(char c, int row, int col, int max_row, int max_col)
-{
-    /*    printf("Filling (%d, %d) with %c\n", row, col, c); */
-    plotter[row][col] = c;
-    if (row > 0 && plotter[row - 1][col] == '.') {
-        flood_fill(c, row - 1, col, max_row, max_col);
-    }
-    if (col > 0 && plotter[row][col - 1] == '.') {
-        flood_fill(c, row, col - 1, max_row, max_col);
-    }
-    if (row < max_row - 1 && plotter[row + 1][col] == '.') {
-        flood_fill(c, row + 1, col, max_row, max_col);
-    }
-    if (col < max_col - 1 && plotter[row][col + 1] == '.') {
-        flood_fill(c, row, col + 1, max_row, max_col);
     }
+    return ground;
 }
 
 
@@ -107,25 +100,33 @@ enum direction {
  * S starting position
  */
 void
-process_file(FILE *fd)
+solve(struct aoc_input *in)
 {
-    char buf[MAX_LEN + 1];
+    int row = -1, col = -1;
 
-    int row = -1, col = -1, max_row = 0, max_col = 0;
+    max_row = 0;
+    max_col = 0;
+    pipes = calloc(in->count + 1, sizeof(char *));
+    if (pipes == NULL) {
+        printf("Oops. Failed to allocate the map.\n");
+        exit(1);
+    }
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
 
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
         if (opts.debug) {
             printf("DEBUG: Line received: '%s'\n", buf);
         }
+        if (!in->lines[lineno].len) {
+            break;
+        }
         if (!max_col) {
-            max_col = strlen(buf);
+            max_col = in->lines[lineno].len;
+        } else if (in->lines[lineno].len != max_col) {
+            printf("Oops. Line %zu is not %d long.\n", lineno + 1, max_col);
+            exit(1);
         }
-        strcpy(pipes[max_row], buf);
-        strcpy(pipes_copy[max_row], buf);
+        pipes[max_row] = buf;
         char *pos = strchr(buf, 'S');
         if (NULL != pos) {
             row = max_row;
@@ -136,19 +137,15 @@ process_file(FILE *fd)
         }
         max_row++;
     }
-    int max_p_row = max_row * 2 + 1;
-    int max_p_col = max_col * 2 + 1;
-    for (int i = 0; i < max_p_row; i++) {
-        for (int j = 0; j < max_p_col; j++) {
-            plotter[i][j] = '.';
-        }
-        plotter[i][max_p_col + 1] = '\0';
-    }
     if (row == -1 && col == -1) {
         printf("No starting point detected.\n");
         exit(1);
     }
-    plotter[row * 2 + 1][col * 2 + 1] = '+';
+    on_loop = calloc(((size_t)max_row * max_col + 63) / 64, sizeof(uint64_t));
+    if (on_loop == NULL) {
+        printf("Oops. Failed to allocate the loop bitmap.\n");
+        exit(1);
+    }
     /*
      * Just because, figure out what pipe the S represents
      */
@@ -170,7 +167,7 @@ process_file(FILE *fd)
             break;
         }
     }
-    if (col < strlen(pipes[row]) - 1) {
+    if (col < max_col - 1) {
         switch (pipes[row][col + 1]) {
         case '-': case 'J': case '7':
             right = true;
@@ -222,32 +219,32 @@ process_file(FILE *fd)
     while (true) {
         distance++;
         int next_row, next_col;
-        pipes[row][col] = '*'; /* Mark as visited */
-        plotter[row * 2 + 1][col * 2 + 1] = '+';
+        mark_loop(row, col);
         switch (dir) {
         case UP:
             next_row = row - 1;
             next_col = col;
-            plotter[row * 2 + 1 - 1][col * 2 + 1] = '+';
             break;
         case RIGHT:
             next_row = row;
             next_col = col + 1;
-            plotter[row * 2 + 1][col * 2 + 1 + 1] = '+';
             break;
         case DOWN:
             next_row = row + 1;
             next_col = col;
-            plotter[row * 2 + 1 + 1][col * 2 + 1] = '+';
             break;
         case LEFT:
             next_row = row;
             next_col = col - 1;
-            plotter[row * 2 + 1][col * 2 + 1 - 1] = '+';
             break;
         }
+        if (next_row < 0 || next_row >= max_row || next_col < 0 || next_col >= max_col) {
+            printf("We ran off the map at (%d, %d) after %d steps?\n",
+                   next_row, next_col, distance);
+            exit(1);
+        }
         char next_symbol = pipes[next_row][next_col];
-        if (next_symbol == '*') {
+        if (is_loop(next_row, next_col)) {
             if (opts.debug) {
                 printf("Reached a previously visited location after %d steps.\n", distance);
             }
@@ -319,130 +316,10 @@ process_file(FILE *fd)
         col = next_col;
     }
 
-    if (opts.debug) {
-        for (int i = 0; i < max_row; i++) {
-            printf("%s\n", pipes[i]);
-        }
-        printf("\n");
-        for (int i = 0; i < max_row * 2 + 1; i++) {
-            printf("%s\n", plotter[i]);
-        }
-        printf("\n");
-    }
-
-    flood_fill('*', 0, 0, max_p_row, max_p_col);
-
-    if (opts.debug) {
-        for (int i = 0; i < max_row * 2 + 1; i++) {
-            printf("%s\n", plotter[i]);
-        }
-        printf("\n");
-    }
-
-    int ground = 0;
-    for (int i = 0; i < max_row; i++) {
-        for (int j = 0; j < max_col; j++) {
-            if (plotter[i * 2 + 1][j * 2 + 1] == '.') {
-                pipes[i][j] = '.';
-                ground++;
-            } else {
-                pipes[i][j] = '+';
-            }
-        }
-    }
-
-    if (opts.debug) {
-        for (int i = 0; i < max_row; i++) {
-            printf("%s\n", pipes[i]);
-        }
-        printf("\n");
-    }
-    printf("Ground enclosed: %d\n", ground);
-}
-
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
-    }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
-    }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
-    }
-#endif
-}
-
-
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC 2023 puzzles; Day 10, part 2\n\
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC 2023 puzzles; Day 10, part 2.\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    long ground = count_enclosed();
+    printf("Ground enclosed: %ld\n", ground);
+    free(pipes);
+    free(on_loop);
+    pipes = NULL;
+    on_loop = NULL;
 }
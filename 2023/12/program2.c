@@ -5,308 +5,240 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# define MAX_LEN 1024
+# include "aoc.h"
 
-struct {
-    bool debug;
-    bool dryrun;
-    bool verbose;
-} opts;
+/* How many copies of the record (and groups) make the real thing */
+# define UNFOLD 5
 
+AOC_PROGRAM(2023, 12, 2);
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
 
+/*
+ * A line of the input: the condition record, and the sizes of the
+ * groups of damaged springs.
+ */
+struct row {
+    char *record;
+    int   len;
+    int  *groups;
+    int   group_total;
+};
+
+/*
+ * What a thread needs to count the arrangements of a row, grown to fit
+ * the biggest one it has seen so far.
+ */
+struct scratch {
+    char *record;
+    int  *groups;
+    int  *run;          /* Number of '#' or '?' starting at each position */
+    long *ways;         /* Two rows of the table, see count_arrangements() */
+    int   size;
+    int   group_size;
+};
+
+static void
+scratch_fit(struct scratch *s, int len, int group_total)
+{
+    if (len > s->size) {
+        s->size = len;
+        s->record = realloc(s->record, s->size + 1);
+        s->run = realloc(s->run, (s->size + 2) * sizeof(int));
+        s->ways = realloc(s->ways, 2 * (s->size + 2) * sizeof(long));
+    }
+    if (group_total > s->group_size) {
+        s->group_size = group_total;
+        s->groups = realloc(s->groups, s->group_size * sizeof(int));
+    }
+    if (s->record == NULL || s->run == NULL || s->ways == NULL || (group_total && s->groups == NULL)) {
+        printf("Oops. Failed to allocate room for a record of %d.\n", len);
+        exit(1);
+    }
+}
 
-int
-main(int argc, char *argv[], char *env[])
+/*
+ * Count the ways the groups fit the record, working back from the end:
+ * ways[g][pos] is the number of arrangements of groups g .. onwards in
+ * the record from pos onwards. A group of width w fits at pos if the
+ * next w spots can all be damaged, and the one after that can not.
+ * Only rows g and g + 1 are needed at any time.
+ */
+static long
+count_arrangements(char *rec, int len, int *groups, int group_total, struct scratch *s)
 {
-    parse_options(&argc, &argv);
+    long *next = s->ways, *cur = s->ways + len + 2;
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
+    s->run[len] = s->run[len + 1] = 0;
+    for (int pos = len - 1; pos >= 0; pos--) {
+        s->run[pos] = rec[pos] == '.' ? 0 : s->run[pos + 1] + 1;
     }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+    /* No groups left: fine, as long as there's no damage left either */
+    next[len] = next[len + 1] = 1;
+    for (int pos = len - 1; pos >= 0; pos--) {
+        next[pos] = rec[pos] == '#' ? 0 : next[pos + 1];
+    }
+    for (int g = group_total - 1; g >= 0; g--) {
+        int width = groups[g];
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
+        cur[len] = cur[len + 1] = 0;
+        for (int pos = len - 1; pos >= 0; pos--) {
+            long ways = rec[pos] == '#' ? 0 : cur[pos + 1];
+
+            if (s->run[pos] >= width && (pos + width == len || rec[pos + width] != '#')) {
+                ways += next[pos + width + 1];
+            }
+            cur[pos] = ways;
         }
-        process_file(fd);
-        fclose(fd);
+        long *tmp = next;
+        next = cur;
+        cur = tmp;
     }
+    return next[0];
 }
 
+/*
+ * The rows are independent of each other, so they're counted in
+ * parallel, each thread with a scratch of its own, writing the count
+ * for each row in its own spot.
+ */
+# define CHUNK 16
 
-char record[MAX_LEN + 1];
-int group_total;
-int grouping[50];
-int needed[50];
-
-/* Keep track of previously calculated numbers of permutations in this */
-long permutations[50][MAX_LEN + 1];
+struct {
+    struct row *rows;
+    long       *counts;
+} work;
 
-long
-map_groups(int pos, int found, char rec[MAX_LEN + 1])
+static void *
+scratch_init()
 {
-    long orig_pos = pos;
-    long perm = 0;
+    struct scratch *s = calloc(1, sizeof(struct scratch));
 
-    /*
-     * Check cache
-     */
-    if (permutations[found][pos] >= 0) {
-        if (opts.debug) {
-            printf("Cache hit for group %d at position %d => %ld\n",
-                   found + 1, pos, permutations[found][pos]);
-        }
-        return permutations[found][pos];
-    }
-    if (opts.debug) {
-        printf("map_groups(%d, %d, ..., %d, ...) next group is %d wide, needs %d\n",
-               pos, found, group_total, grouping[found], needed[found]);
-    }
-    if (found == group_total) {
-        /* Make sure only . or ? left */
-        for (int i = pos; i < strlen(rec); i++) {
-            if (rec[i] == '#') {
-                return 0;
-            }
-        }
-        if (opts.debug) {
-            printf("Permutation found\n");
-        }
-        permutations[found][pos] = 1;
-        return 1;
+    if (s == NULL) {
+        printf("Oops. Failed to allocate the scratch space.\n");
+        exit(1);
     }
-    /* As long as there is enough room */
-    while (strlen(rec) - pos >= needed[found]) {
-        int width = grouping[found];
-        /* Are the next X characters either '?' or '#' */
-        bool possible = true;
-        for (int i = 0; i < width; i++) {
-            if (rec[pos + i] == '.') {
-                possible = false;
-                break;
-            }
-        }
-        if (possible && rec[pos + width] != '#') {
-            /* ?, ., or \0 */
-            perm += map_groups(pos + width + 1, found + 1, rec);
-        }
+    return s;
+}
 
-        if (rec[pos] == '#') {
-            break;
-        }
+static void
+scratch_free(void *scratch)
+{
+    struct scratch *s = scratch;
 
-        /* ? or . */
-        pos++;
-    }
-    permutations[found][orig_pos] = perm;
-    return perm;
+    free(s->record);
+    free(s->groups);
+    free(s->run);
+    free(s->ways);
+    free(s);
 }
 
-
-void
-process_file(FILE *fd)
+static bool
+count_rows(void *scratch, long from, long end)
 {
-    char buf[MAX_LEN + 1];
+    struct scratch *s = scratch;
 
-    long perm_total = 0;
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            printf("DEBUG: Line received: '%s'\n", buf);
-        }
-        char groups[MAX_LEN + 1];
+    for (long i = from; i < end; i++) {
+        struct row *row = &work.rows[i];
+        int len = row->len * UNFOLD + UNFOLD - 1;
+        int group_total = row->group_total * UNFOLD;
 
-        sscanf(buf, "%[?.#] %[0-9,]", record, groups);
-        if (opts.debug) {
-            printf("Record '%s' and groups '%s'\n", record, groups);
-        }
-        group_total = 0;
-        char *cur = groups;
-        while (true) {
-            int n, len;
+        /* Unfold, with a '?' between the copies */
+        scratch_fit(s, len, group_total);
+        for (int copy = 0; copy < UNFOLD; copy++) {
+            char *to = s->record + copy * (row->len + 1);
 
-            if (sscanf(cur, "%d%n", &n, &len)) {
-                grouping[group_total] = n;
-                group_total++;
-            }
-            cur += len;
-            if (cur[0] != ',') {
-                break;
-            }
-            cur++;
-        }
-        /*
-         * Unfold
-         */
-        for (int i = 1; i <= 5; i++) {
-            for (int j = 0; j < group_total; j++) {
-                grouping[group_total * i + j] = grouping[j];
+            memcpy(to, row->record, row->len);
+            if (copy < UNFOLD - 1) {
+                to[row->len] = '?';
             }
+            memcpy(s->groups + copy * row->group_total, row->groups, row->group_total * sizeof(int));
         }
-        char new_rec[MAX_LEN + 1];
-        strcpy(new_rec, record);
-        for (int i = 0; i < 4; i++) {
-            strcat(new_rec, "?");
-            strcat(new_rec, record);
+        s->record[len] = '\0';
+        work.counts[i] = count_arrangements(s->record, len, s->groups, group_total, s);
+        if (opts.debug) {
+            printf("#Arrangements for %s: %ld\n", s->record, work.counts[i]);
         }
-        strcpy(record, new_rec);
-        group_total *= 5;
+    }
+    return true;
+}
 
-        /*
-         * Calculate space needed for each group, for some optimization
-         */
-        needed[group_total - 1] = grouping[group_total - 1];
-        for (int i = group_total - 2; i >= 0; i--) {
-            needed[i] = needed[i + 1] + 1 + grouping[i];
-        }
+void
+solve(struct aoc_input *in)
+{
+    struct row *rows = malloc((in->count + 1) * sizeof(struct row));
+    int row_total = 0;
+
+    if (rows == NULL) {
+        printf("Oops. Failed to allocate the rows.\n");
+        exit(1);
+    }
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
 
         if (opts.debug) {
-            printf("New record:\n    %s\n", record);
-            printf("New group total:    %d\n", group_total);
-            printf("Groups and needed arrays:\n");
-            for (int i = 0; i < group_total; i++) {
-                printf("    %3d - %3d\n", grouping[i], needed[i]);
-            }
+            printf("DEBUG: Line received: '%s'\n", buf);
         }
-
-        /*
-         * Prefill the 'permutations' array (a bit overkill, but meh)
-         */
-        for (int i = 0; i <= group_total; i++) {
-            for (int j = 0; j < MAX_LEN + 1; j++) {
-                permutations[i][j] = -1;
+        if (!in->lines[lineno].len) {
+            continue;
+        }
+        struct row *row = &rows[row_total];
+        char *space = strchr(buf, ' ');
+        if (space == NULL || strspn(buf, "?.#") != (size_t)(space - buf)) {
+            printf("Oops. Can't make sense of '%s'.\n", buf);
+            exit(1);
+        }
+        *space = '\0';
+        row->record = buf;
+        row->len = space - buf;
+
+        /* There can't be more groups than numbers on the line */
+        row->groups = malloc((strlen(space + 1) / 2 + 1) * sizeof(int));
+        if (row->groups == NULL) {
+            printf("Oops. Failed to allocate the groups.\n");
+            exit(1);
+        }
+        row->group_total = 0;
+        char *cur = space + 1;
+        while (*cur) {
+            char *end;
+            long n = strtol(cur, &end, 10);
+
+            if (end == cur || n <= 0) {
+                printf("Oops. Bad group size in '%s'.\n", space + 1);
+                exit(1);
             }
+            row->groups[row->group_total++] = n;
+            cur = *end == ',' ? end + 1 : end;
         }
-        long perm = map_groups(0, 0, record);
         if (opts.debug) {
-            printf("#Arrangements for %s: %ld\n", record, perm);
+            printf("Record '%s' and %d groups\n", row->record, row->group_total);
         }
-        perm_total += perm;
+        row_total++;
     }
     if (opts.debug) {
         printf("DEBUG: End of file\n");
     }
-    printf("Total #arrangements for this set: %ld\n", perm_total);
-}
-
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
-    }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
-    }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
-    }
-#endif
-}
-
 
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
+    long *counts = malloc((row_total + 1) * sizeof(long));
+    if (counts == NULL) {
+        printf("Oops. Failed to allocate the counts.\n");
+        exit(1);
     }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC 2023 puzzles; Day 12, part 2\n\
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
+    work.rows = rows;
+    work.counts = counts;
+    aoc_parallel_for(row_total, CHUNK, scratch_init, count_rows, NULL, scratch_free);
+    long perm_total = 0;
+    for (int i = 0; i < row_total; i++) {
+        perm_total += counts[i];
+        free(rows[i].groups);
     }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC 2023 puzzles; Day 12, part 2.\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    printf("Total #arrangements for this set: %ld\n", perm_total);
+    free(counts);
+    free(rows);
 }
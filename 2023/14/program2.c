@@ -5,385 +5,400 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
+# include <stdint.h>     /* uint64_t             */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# define YEAR 2023
-# define DAY    14
-# define PART    2
+# include "aoc.h"
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
+# define CYCLES 1000000000
 
-# define MAX_LEN 1024
+AOC_PROGRAM(2023, 14, 2);
 
-# define MAX_PATTERN 200
 
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
+/*
+ * The platform is kept as a square bit matrix, of size (multiple of
+ * 64) by size: a row is words 64-bit words, with column c in bit c % 64
+ * of word c / 64. Anything beyond the actual platform counts as a cube
+ * rock, so nothing ever rolls there.
+ *
+ * A tilt only ever moves rocks along the rows, west or east: the
+ * north and south tilts are done on the transposed platform, where the
+ * columns are the rows.
+ */
+int size, words;
+int max_row, max_col;
+
+uint64_t *rocks = NULL;
+uint64_t *scratch = NULL;
 
+/*
+ * Between the cube rocks (which never move) every row falls apart in
+ * segments, within which the round rocks all end up at one end. Those
+ * are the same every time, so they're worked out once, for both the
+ * platform and its transposition.
+ */
+struct segment {
+    int start, end;
+};
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+struct segments {
+    struct segment  *segments;
+    int             *first;     /* Per row, plus one at the end */
+} row_segments, col_segments;
 
+static inline bool
+bit_set(uint64_t *row, int col)
+{
+    return (row[col / 64] >> (col % 64)) & 1;
+}
 
 /*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
+ * Bits start .. end - 1 of a row, as a mask for word w
  */
-int
-main(int argc, char *argv[], char *env[])
+static inline uint64_t
+range_mask(int w, int start, int end)
 {
-    parse_options(&argc, &argv);
+    int lo = w * 64, hi = lo + 64;
+    uint64_t mask = ~0ULL;
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
+    if (start > lo) {
+        mask &= ~0ULL << (start - lo);
     }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
-
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
-
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
-        }
-        process_file(fd);
-        fclose(fd);
+    if (end < hi) {
+        mask &= ~0ULL >> (hi - end);
     }
+    return mask;
 }
 
+static void
+tilt(uint64_t *matrix, struct segments *segs, bool towards_start)
+{
+    for (int row = 0; row < size; row++) {
+        uint64_t *bits = &matrix[row * words];
 
-char map[200][200];
-
+        for (int s = segs->first[row]; s < segs->first[row + 1]; s++) {
+            int start = segs->segments[s].start, end = segs->segments[s].end;
+            int count = 0;
 
-void
-shift_north(int max_row, int max_col)
-{
-    for (int col = 0; col < max_col; col++) {
-        int target = 0;
+            for (int w = start / 64; w <= (end - 1) / 64; w++) {
+                uint64_t mask = range_mask(w, start, end);
 
-        for (int row = 0; row < max_row; row++) {
-            switch (map[row][col]) {
-            case '#':
-                target = row + 1;
-                break;
-            case 'O':
-                if (row == target) {
-                    target++;
-                } else {
-                    map[target][col] = 'O';
-                    map[row][col] = '.';
-                    target++;
-                }
-                break;
-            case '.':
-                break;
+                count += __builtin_popcountll(bits[w] & mask);
+                bits[w] &= ~mask;
+            }
+            if (count == 0) {
+                continue;
+            }
+            if (towards_start) {
+                end = start + count;
+            } else {
+                start = end - count;
+            }
+            for (int w = start / 64; w <= (end - 1) / 64; w++) {
+                bits[w] |= range_mask(w, start, end);
             }
         }
     }
 }
 
-
-void
-shift_east(int max_row, int max_col)
+/*
+ * Transpose a 64x64 bit block in place (bit c of word r ends up as
+ * bit r of word c), swapping ever smaller sub-blocks.
+ */
+static void
+transpose64(uint64_t a[64])
 {
-    for (int row = 0; row < max_row; row++) {
-        int target = 0;
+    uint64_t m = 0x00000000ffffffffULL;
 
-        for (int col = 0; col < max_col; col++) {
-            switch (map[row][col]) {
-            case '#':
-                target = col + 1;
-                break;
-            case 'O':
-                if (col == target) {
-                    target++;
-                } else {
-                    map[row][target] = 'O';
-                    map[row][col] = '.';
-                    target++;
-                }
-                break;
-            case '.':
-                break;
-            }
+    for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k | j] ^= t;
+            a[k] ^= t << j;
         }
     }
 }
 
-
-void
-shift_south(int max_row, int max_col)
+static void
+transpose(uint64_t *from, uint64_t *to)
 {
-    for (int col = 0; col < max_col; col++) {
-        int target = max_row - 1;
+    uint64_t block[64];
 
-        for (int row = max_row - 1; row >= 0; row--) {
-            switch (map[row][col]) {
-            case '#':
-                target = row - 1;
-                break;
-            case 'O':
-                if (row == target) {
-                    target--;
-                } else {
-                    map[target][col] = 'O';
-                    map[row][col] = '.';
-                    target--;
-                }
-                break;
-            case '.':
-                break;
+    for (int bi = 0; bi < words; bi++) {
+        for (int bj = 0; bj < words; bj++) {
+            for (int r = 0; r < 64; r++) {
+                block[r] = from[(bi * 64 + r) * words + bj];
+            }
+            transpose64(block);
+            for (int r = 0; r < 64; r++) {
+                to[(bj * 64 + r) * words + bi] = block[r];
             }
         }
     }
 }
 
-
-void
-shift_west(int max_row, int max_col)
+static void
+find_segments(uint64_t *cubes, struct segments *segs)
 {
-    for (int row = 0; row < max_row; row++) {
-        int target = max_col - 1;
+    int total = 0;
 
-        for (int col = max_col - 1; col >= 0; col--) {
-            switch (map[row][col]) {
-            case '#':
-                target = col - 1;
-                break;
-            case 'O':
-                if (col == target) {
-                    target--;
-                } else {
-                    map[row][target] = 'O';
-                    map[row][col] = '.';
-                    target--;
-                }
-                break;
-            case '.':
-                break;
-             }
+    segs->segments = malloc((size_t)size * (size / 2 + 1) * sizeof(struct segment));
+    segs->first = malloc((size + 1) * sizeof(int));
+    if (segs->segments == NULL || segs->first == NULL) {
+        printf("Oops. Failed to allocate the segments.\n");
+        exit(1);
+    }
+    for (int row = 0; row < size; row++) {
+        int start = 0;
+
+        segs->first[row] = total;
+        for (int col = 0; col <= size; col++) {
+            if (col < size && !bit_set(&cubes[row * words], col)) {
+                continue;
+            }
+            /* A single spot can't go anywhere */
+            if (col - start > 1) {
+                segs->segments[total].start = start;
+                segs->segments[total].end = col;
+                total++;
+            }
+            start = col + 1;
         }
     }
+    segs->first[size] = total;
 }
 
+/*
+ * One spin cycle: north, west, south, east
+ */
+static void
+spin_cycle()
+{
+    transpose(rocks, scratch);
+    tilt(scratch, &col_segments, true);
+    transpose(scratch, rocks);
+    tilt(rocks, &row_segments, true);
+    transpose(rocks, scratch);
+    tilt(scratch, &col_segments, false);
+    transpose(scratch, rocks);
+    tilt(rocks, &row_segments, false);
+}
 
-int
-calculate_load(int max_row, int max_col)
+static int
+calculate_load()
 {
     int load = 0;
 
-    for (int col = 0; col < max_col; col++) {
-        for (int row = 0; row < max_row; row++) {
-            if (map[row][col] == 'O') {
-                load += (max_row - row);
-            }
+    for (int row = 0; row < max_row; row++) {
+        int count = 0;
+
+        for (int w = 0; w < words; w++) {
+            count += __builtin_popcountll(rocks[row * words + w]);
         }
+        load += count * (max_row - row);
     }
     return load;
 }
 
-
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * Every state the platform has been in (after 0, 1, ... cycles), with
+ * an open addressing table on the hash of the states to find a repeat.
+ * Matches are compared in full, so a hash collision can't fool it.
  */
-void
-process_file(FILE *fd)
+uint64_t *history = NULL;
+int *loads = NULL;
+int history_total, history_size;
+
+int *table = NULL;
+int table_size;
+
+static uint64_t
+hash_state(uint64_t *state)
 {
-    char buf[MAX_LEN + 1];
-    int max_row = 0, max_col = 0;
-    int repetitions[MAX_PATTERN];
-    for (int i = 0; i < MAX_PATTERN; i++) {
-        repetitions[i] = 0;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (int i = 0; i < size * words; i++) {
+        hash ^= state[i];
+        hash *= 0x100000001b3ULL;
+        hash ^= hash >> 29;
     }
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            printf("DEBUG: Line received: '%s'\n", buf);
-        }
-        strcpy(map[max_row], buf);
-        if (!max_col) {
-            max_col = strlen(buf);
-        }
-        max_row++;
+    return hash;
+}
+
+static void
+table_grow()
+{
+    free(table);
+    table_size = table_size ? table_size * 2 : 1024;
+    table = malloc(table_size * sizeof(int));
+    if (table == NULL) {
+        printf("Oops. Failed to allocate the state table.\n");
+        exit(1);
     }
-    if (opts.debug) {
-        printf("DEBUG: End of file\n");
+    for (int i = 0; i < table_size; i++) {
+        table[i] = -1;
     }
-    for (int cycle = 1; cycle < MAX_PATTERN * 5; cycle++) {
-        shift_north(max_row, max_col);
-        shift_east(max_row, max_col);
-        shift_south(max_row, max_col);
-        shift_west(max_row, max_col);
-        int load = calculate_load(max_row, max_col);
-        if (opts.debug) {
-            printf("Cycle %d - Total load: %d\n", cycle + 1, load);
-        }
-        int detections = 0;
-        for (int i = 0; i < MAX_PATTERN; i++) {
-            if (repetitions[i] == load) {
-                detections++;
-                if (detections == 2) {
-                    int length = i + 1;
-                    if (length > 2 && length % 2 == 0) {
-                        length /= 2;
-                        if (opts.debug) {
-                            printf("Found 2 repeats at cycle %d (%d) - checking pattern\n", cycle, i);
-                        }
-                        bool repeating = true;
-                        for (int j = 0; j < length; j++) {
-                            if (repetitions[j] != repetitions[j + length]) {
-                                repeating = false;
-                                break;
-                            }
-                        }
-                        if (repeating) {
-                            printf("Confirmed the pattern fully repeats at cycle %d (length of pattern is %d)!\n", cycle, length);
-                            long remainder = 1000000000 - cycle;
-                            printf("  Remaining cycles: %ld\n", remainder);
-                            printf("  Full pattern repeats in that: %ld\n", remainder / length);
-                            long cycles_left = remainder % length;
-                            printf("  Cycles remaining after that: %ld\n", cycles_left);
-                            printf("The final load after those cycles: %d\n",
-                                   repetitions[length - 1 - cycles_left]);
-                            exit(0);
-                        }
-                    }
-                }
-            }
-        }
-        for (int i = MAX_PATTERN - 1; i >= 1; i--) {
-            repetitions[i] = repetitions[i - 1];
+    for (int i = 0; i < history_total; i++) {
+        uint64_t slot = hash_state(&history[(size_t)i * size * words]) & (table_size - 1);
+
+        while (table[slot] != -1) {
+            slot = (slot + 1) & (table_size - 1);
         }
-        repetitions[0] = load;
+        table[slot] = i;
     }
-    int load = calculate_load(max_row, max_col);
-    printf("Final total load: %d\n", load);
 }
 
-
 /*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
+ * Remember the current state, unless it has been seen before, in which
+ * case the cycle it was first seen after is returned (and -1 if not).
  */
-void
-parse_options(int *argc, char **argv[])
+static int
+remember_state()
 {
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
+    size_t state_words = (size_t)size * words;
+    uint64_t hash = hash_state(rocks);
+    uint64_t slot = hash & (table_size - 1);
 
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
+    while (table[slot] != -1) {
+        if (!memcmp(&history[table[slot] * state_words], rocks, state_words * sizeof(uint64_t))) {
+            return table[slot];
+        }
+        slot = (slot + 1) & (table_size - 1);
     }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
+    if (history_total == history_size) {
+        history_size *= 2;
+        history = realloc(history, history_size * state_words * sizeof(uint64_t));
+        loads = realloc(loads, history_size * sizeof(int));
+        if (history == NULL || loads == NULL) {
+            printf("Oops. Failed to grow the history to %d states.\n", history_size);
+            exit(1);
         }
     }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
+    memcpy(&history[history_total * state_words], rocks, state_words * sizeof(uint64_t));
+    loads[history_total] = calculate_load();
+    table[slot] = history_total;
+    history_total++;
+    /* Keep the table at most half full */
+    if (history_total * 2 > table_size) {
+        table_grow();
     }
-#endif
+    return -1;
 }
 
-
 /*
- * Print a minimal usage blurb for the program.
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
+solve(struct aoc_input *in)
 {
-    char *name;
+    max_row = 0;
+    max_col = 0;
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        if (in->lines[lineno].len == 0) {
+            break;
+        }
+        if (in->lines[lineno].len > max_col) {
+            max_col = in->lines[lineno].len;
+        }
+        max_row++;
+    }
+    size = max_row > max_col ? max_row : max_col;
+    size = (size + 63) / 64 * 64;
+    words = size / 64;
+    if (size == 0) {
+        printf("Oops. No platform found.\n");
+        exit(1);
+    }
+
+    size_t state_words = (size_t)size * words;
+    uint64_t *cubes = malloc(state_words * sizeof(uint64_t));
+    uint64_t *cubes_t = malloc(state_words * sizeof(uint64_t));
+    rocks = calloc(state_words, sizeof(uint64_t));
+    scratch = malloc(state_words * sizeof(uint64_t));
+    if (cubes == NULL || cubes_t == NULL || rocks == NULL || scratch == NULL) {
+        printf("Oops. Failed to allocate the platform.\n");
+        exit(1);
+    }
+    /* Everything is a cube rock, until it turns out not to be */
+    memset(cubes, 0xff, state_words * sizeof(uint64_t));
+    for (int row = 0; row < max_row; row++) {
+        char *buf = in->lines[row].str;
+
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        for (int col = 0; col < in->lines[row].len; col++) {
+            uint64_t bit = 1ULL << (col % 64);
 
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
+            switch (buf[col]) {
+            case 'O':
+                rocks[row * words + col / 64] |= bit;
+                /* Fall through */
+            case '.':
+                cubes[row * words + col / 64] &= ~bit;
+                break;
+            }
+        }
+    }
+    if (opts.debug) {
+        printf("DEBUG: End of file\n");
+    }
+    transpose(cubes, cubes_t);
+    find_segments(cubes, &row_segments);
+    find_segments(cubes_t, &col_segments);
+    free(cubes);
+    free(cubes_t);
+
+    history_total = 0;
+    history_size = 64;
+    history = malloc(history_size * state_words * sizeof(uint64_t));
+    loads = malloc(history_size * sizeof(int));
+    table_size = 0;
+    if (history == NULL || loads == NULL) {
+        printf("Oops. Failed to allocate the history.\n");
+        exit(1);
+    }
+    table_grow();
+
+    int first = remember_state();
+    int cycle = 0;
+    while (first < 0 && cycle < CYCLES) {
+        spin_cycle();
+        cycle++;
+        first = remember_state();
+        if (opts.debug) {
+            printf("Cycle %d - Total load: %d\n", cycle, calculate_load());
+        }
     }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
+    if (first < 0) {
+        printf("Final total load: %d\n", calculate_load());
+    } else {
+        int length = cycle - first;
+
+        printf("Confirmed the pattern fully repeats at cycle %d (length of pattern is %d)!\n", cycle, length);
+        long remainder = CYCLES - cycle;
+        printf("  Remaining cycles: %ld\n", remainder);
+        printf("  Full pattern repeats in that: %ld\n", remainder / length);
+        long cycles_left = remainder % length;
+        printf("  Cycles remaining after that: %ld\n", cycles_left);
+        printf("The final load after those cycles: %d\n", loads[first + cycles_left]);
     }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    free(row_segments.segments);
+    free(row_segments.first);
+    free(col_segments.segments);
+    free(col_segments.first);
+    free(history);
+    free(loads);
+    free(table);
+    free(rocks);
+    free(scratch);
+    history = NULL;
+    loads = NULL;
+    table = NULL;
+    rocks = NULL;
+    scratch = NULL;
 }
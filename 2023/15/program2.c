@@ -5,195 +5,242 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
+# include <stdint.h>     /* uint32_t             */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2023
-# define DAY    15
-# define PART    2
+AOC_STREAM_PROGRAM(2023, 15, 2);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
 
-# define MAX_LEN 32768
+/*
+ * Every label that shows up gets a lens entry, for good: the label is
+ * kept in label_text (the input only comes by a chunk at a time), and
+ * the box it goes in (its HASH) is worked out once. While it's in its
+ * box, it's on that box's list, in the order the lenses were put in.
+ */
+struct lens {
+    size_t      label;      /* Where in label_text */
+    int         len;
+    uint32_t    hash;       /* For the table below, not the box */
+    int         box;
+    int         focal;
+    bool        in_box;
+    int         prev, next;
+} *lenses = NULL;
+int lens_total, lens_size;
+
+char *label_text = NULL;
+size_t text_total, text_size;
 
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
+struct box {
+    int first, last;
+} boxes[256];
 
+/*
+ * Open addressing table from label to lens, kept at most half full
+ */
+int *table = NULL;
+int table_size;
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+static uint32_t
+hash_label(const char *label, int len)
+{
+    uint32_t hash = 2166136261u;
 
+    for (int i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)label[i]) * 16777619u;
+    }
+    return hash;
+}
 
-/*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
- */
-int
-main(int argc, char *argv[], char *env[])
+static void
+table_grow()
 {
-    parse_options(&argc, &argv);
+    free(table);
+    table_size = table_size ? table_size * 2 : 1024;
+    table = malloc(table_size * sizeof(int));
+    if (table == NULL) {
+        printf("Oops. Failed to allocate the label table.\n");
+        exit(1);
+    }
+    for (int i = 0; i < table_size; i++) {
+        table[i] = -1;
+    }
+    for (int l = 0; l < lens_total; l++) {
+        uint32_t slot = lenses[l].hash & (table_size - 1);
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
+        while (table[slot] != -1) {
+            slot = (slot + 1) & (table_size - 1);
         }
-        process_file(stdin);
-        return 0;
+        table[slot] = l;
     }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
+}
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+/*
+ * Find the lens for a label, adding it if it's new
+ */
+static int
+find_lens(const char *label, int len, int box)
+{
+    uint32_t hash = hash_label(label, len);
+    uint32_t slot = hash & (table_size - 1);
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
+    while (table[slot] != -1) {
+        struct lens *lens = &lenses[table[slot]];
+
+        if (lens->hash == hash && lens->len == len && !memcmp(label_text + lens->label, label, len)) {
+            return table[slot];
         }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
+        slot = (slot + 1) & (table_size - 1);
+    }
+    if (lens_total == lens_size) {
+        lens_size = lens_size ? lens_size * 2 : 1024;
+        lenses = realloc(lenses, lens_size * sizeof(struct lens));
+        if (lenses == NULL) {
+            printf("Oops. Failed to grow the lenses to %d.\n", lens_size);
+            exit(1);
         }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
+    }
+    if (text_total + len > text_size) {
+        while (text_total + len > text_size) {
+            text_size = text_size ? text_size * 2 : 65536;
         }
-        process_file(fd);
-        fclose(fd);
+        label_text = realloc(label_text, text_size);
+        if (label_text == NULL) {
+            printf("Oops. Failed to grow the labels to %zu.\n", text_size);
+            exit(1);
+        }
+    }
+    memcpy(label_text + text_total, label, len);
+
+    struct lens *lens = &lenses[lens_total];
+    lens->label = text_total;
+    text_total += len;
+    lens->len = len;
+    lens->hash = hash;
+    lens->box = box;
+    lens->in_box = false;
+    table[slot] = lens_total;
+    lens_total++;
+    if (lens_total * 2 > table_size) {
+        table_grow();
     }
+    return lens_total - 1;
 }
 
-
 /*
- * Data structure to keep my head sane, with ample buffer for however
- * many lenses might theoretically end up in one of the boxes, and
- * crazy extra space for the labels, much more than we saw in practice
- * in the input.
+ * If the lens is already in its box, it just gets the new focal
+ * length. Otherwise it goes at the end of the list.
  */
-struct box {
-    int total;
-    struct lens {
-        char label[100];
-        int focal;
-    } lenses[100];
-} boxes[256];
+static void
+add_to_box(int l, int focal)
+{
+    struct lens *lens = &lenses[l];
+    struct box *box = &boxes[lens->box];
 
+    lens->focal = focal;
+    if (lens->in_box) {
+        return;
+    }
+    lens->in_box = true;
+    lens->prev = box->last;
+    lens->next = -1;
+    if (box->last == -1) {
+        box->first = l;
+    } else {
+        lenses[box->last].next = l;
+    }
+    box->last = l;
+}
 
-/*
- * If a lens with the same label is already present, put this one in
- * its place. Otherwise add an entry at the end of the list.
- */
-void
-add_to_box(int box, char *label, int focal)
+static void
+remove_from_box(int l)
 {
-    int total = boxes[box].total;
+    struct lens *lens = &lenses[l];
+    struct box *box = &boxes[lens->box];
 
-    if (total == 0) {
-        strcpy(boxes[box].lenses[0].label, label);
-        boxes[box].lenses[0].focal = focal;
-        boxes[box].total = 1;
+    if (!lens->in_box) {
         return;
     }
-    for (int i = 0; i < boxes[box].total; i++) {
-        if (!strcmp(boxes[box].lenses[i].label, label)) {
-            /* Replace this lens */
-            boxes[box].lenses[i].focal = focal;
-            return;
-        }
+    lens->in_box = false;
+    if (lens->prev == -1) {
+        box->first = lens->next;
+    } else {
+        lenses[lens->prev].next = lens->next;
+    }
+    if (lens->next == -1) {
+        box->last = lens->prev;
+    } else {
+        lenses[lens->next].prev = lens->prev;
     }
-    strcpy(boxes[box].lenses[total].label, label);
-    boxes[box].lenses[total].focal = focal;
-    boxes[box].total++;
 }
 
-
-/*
- * If a lens with the same label is found, remove it, and shift the
- * other lenses forward
- */
-void
-remove_from_box(int box, char *label)
+static void
+dump_boxes()
 {
-    for (int i = 0; i < boxes[box].total; i++) {
-        if (!strcmp(boxes[box].lenses[i].label, label)) {
-            for (int j = i; j < boxes[box].total; j++) {
-                strcpy(boxes[box].lenses[j].label, boxes[box].lenses[j + 1].label);
-                boxes[box].lenses[j].focal = boxes[box].lenses[j + 1].focal;
-            }
-            boxes[box].total--;
-            return;
+    for (int b = 0; b < 256; b++) {
+        if (boxes[b].first == -1) {
+            continue;
+        }
+        printf("Box %d:", b);
+        for (int l = boxes[b].first; l != -1; l = lenses[l].next) {
+            printf(" [%.*s %d]", lenses[l].len, label_text + lenses[l].label, lenses[l].focal);
         }
+        printf("\n");
     }
+    printf("\n");
 }
 
 /*
- * Process one of the lens placement instructions
+ * Process a lens placement instruction: a label, followed by = and a
+ * focal length, or by -.
  */
-void
-process_step(char *step)
+static void
+process_step(const char *step, size_t step_len)
 {
-    char label[100];
-
+    const char *cur = step, *end = step + step_len;
+    const char *label = cur;
     int val = 0;
-    int i = 0;
-    for (; i < strlen(step); i++) {
-        if (step[i] >= 'a' && step[i] <= 'z') {
-            label[i] = step[i];
-            val = ((val + step[i]) * 17) % 256;
-        } else {
-            /* Collect label characters as we go. */
-            label[i] = '\0';
-            break;
-        }
-    }
-
-    int foc_len;
 
+    while (cur < end && *cur != '=' && *cur != '-') {
+        val = ((val + *cur) * 17) % 256;
+        cur++;
+    }
+    int len = cur - label;
+    if (cur == end) {
+        printf("Oops. Step '%.*s' does nothing.\n", len, label);
+        exit(1);
+    }
     if (opts.debug) {
-        printf("Label %s value: %d\n", label, val);
+        printf("Label %.*s value: %d\n", len, label, val);
     }
-    switch (step[i]) {
-    case '=':
-        foc_len = step[i + 1] - '0';
+    int l = find_lens(label, len, val);
+    if (*cur++ == '=') {
+        int focal = 0;
+
+        while (cur < end && *cur >= '0' && *cur <= '9') {
+            focal = focal * 10 + *cur++ - '0';
+        }
         if (opts.debug) {
-            printf("focal length for box %d: %d\n", val, foc_len);
+            printf("focal length for box %d: %d\n", val, focal);
         }
-        add_to_box(val, label, foc_len);
-        break;
-    case '-':
+        add_to_box(l, focal);
+    } else {
         if (opts.debug) {
             printf("Remove lens from box %d?\n", val);
         }
-        remove_from_box(val, label);
-        break;
+        remove_from_box(l);
+    }
+    if (cur < end) {
+        printf("Oops. Unexpected '%c' after step '%.*s'.\n", *cur, len, label);
+        exit(1);
     }
     if (opts.debug) {
-        for (int i = 0; i < 256; i++) {
-            if (boxes[i].total > 0) {
-                printf("Box %d:", i);
-                for (int j = 0; j < boxes[i].total; j++) {
-                    printf(" [%s %d]", boxes[i].lenses[j].label, boxes[i].lenses[j].focal);
-                }
-                printf("\n");
-            }
-        }
-        printf("\n");
+        dump_boxes();
     }
 }
 
@@ -201,173 +248,64 @@ process_step(char *step)
 /*
  * Calculate the focal power of the lenses in one of the boxes
  */
-int
+long
 box_power(int box)
 {
-    int power = 0;
+    long power = 0;
+    int slot = 1;
 
-    for (int i = 0; i < boxes[box].total; i++) {
-        power += (box + 1) * (i + 1) * boxes[box].lenses[i].focal;
+    for (int l = boxes[box].first; l != -1; l = lenses[l].next) {
+        power += (long)(box + 1) * slot++ * lenses[l].focal;
     }
     return power;
 }
 
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * Go through the steps of the input one at a time (the runtime reads
+ * it in chunks, as the steps can go on for ever), and then add up the
+ * focal power.
  */
 void
-process_file(FILE *fd)
+solve(struct aoc_input *in)
 {
-    char buf[MAX_LEN + 1];
+    struct aoc_line step;
 
     for (int i = 0; i < 256; i++) {
-        boxes[i].total = 0;
+        boxes[i].first = boxes[i].last = -1;
     }
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
+    lens_total = 0;
+    text_total = 0;
+    table_size = 0;
+    table_grow();
+    while (aoc_token(in, ",\n", &step)) {
         if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
-
-            SHA256((unsigned char *)buf, strlen(buf), digest);
-
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
-
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
+            printf("DEBUG: Step received: '%s'\n", step.str);
         }
-        char *cur = buf;
-        while (true) {
-            char *sep;
-
-            sep = strchr(cur, ',');
-            if (NULL != sep) {
-                sep[0] = '\0';
-            }
-            if (opts.debug) {
-                printf("Step: %s\n", cur);
-            }
-            process_step(cur);
-            if (NULL == sep) {
-                break;
-            }
-            cur = sep + 1;
+        if (step.len) {
+            process_step(step.str, step.len);
         }
     }
-    int sum_power = 0;
+    long sum_power = 0;
     for (int i = 0; i < 256; i++) {
-        if (boxes[i].total > 0) {
-            int power = box_power(i);
+        if (boxes[i].first != -1) {
+            long power = box_power(i);
             if (opts.debug) {
-                printf("Box %d power: %d\n", i, power);
+                printf("Box %d power: %ld\n", i, power);
             }
             sum_power += power;
         }
     }
-    printf("Sum of power: %d\n", sum_power);
+    printf("Sum of power: %ld\n", sum_power);
     if (opts.debug) {
         printf("DEBUG: End of file\n");
     }
-}
-
-
-/*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
- */
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
-    }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
-    }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
-    }
-#endif
-}
-
-
-/*
- * Print a minimal usage blurb for the program.
- */
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    free(lenses);
+    free(label_text);
+    free(table);
+    lenses = NULL;
+    label_text = NULL;
+    table = NULL;
+    lens_size = 0;
+    text_size = 0;
 }
@@ -5,79 +5,14 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2023
-# define DAY    16
-# define PART    1
-
-# define STR(x) _STR(x)
-# define _STR(x) #x
-
-# define MAX_LEN 1024
-
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
-
-
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
-
-
-/*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
- */
-int
-main(int argc, char *argv[], char *env[])
-{
-    parse_options(&argc, &argv);
-
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
-    }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
-
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
-
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
-        }
-        process_file(fd);
-        fclose(fd);
-    }
-}
+AOC_PROGRAM(2023, 16, 1);
 
 
 typedef enum direction {
@@ -89,39 +24,36 @@ char direction_chars[sizeof(direction)] = {'^', '>', 'v', '<'};
 direction trans_backslash[sizeof(direction)] = { LEFT, DOWN, RIGHT, UP };
 direction trans_slash[sizeof(direction)] = { RIGHT, UP, LEFT, DOWN };
 
+/* The map rows point into the input */
 int max_row = 0, max_col = 0;
-char map[120][120];
+char **map = NULL;
 
 struct meta {
     bool energized  : 1;
     bool seen[sizeof(direction)];
-} metadata[120][120];
+} *metadata = NULL;
 
 int energized_total;
 
 void
 meta_init(int max_row, int max_col)
 {
-    for (int i = 0; i < max_row; i++) {
-        for (int j = 0; j < max_col; j++) {
-            metadata[i][j].energized   = false;
-            for (int k = 0; k < sizeof(direction); k++) {
-                metadata[i][j].seen[k] = false;
-            }
-        }
+    free(metadata);
+    metadata = calloc((size_t)max_row * max_col, sizeof(struct meta));
+    if (metadata == NULL) {
+        printf("Oops. Failed to allocate the metadata.\n");
+        exit(1);
     }
     energized_total = 0;
 }
 
-# define MAX_BEAMS 100
-
 struct beam {
     direction dir;
     int row;
     int col;
     bool done;
-} beams[MAX_BEAMS];
-int beam_count = 0;
+} *beams = NULL;
+int beam_count = 0, beam_size = 0;
 
 
 void
@@ -133,9 +65,13 @@ beam_init()
 void
 beam_add(int row, int col, direction dir)
 {
-    if (beam_count == MAX_BEAMS) {
-        printf("Failed to add another beam. Increase the max (currently %d)\n", MAX_BEAMS);
-        exit(1);
+    if (beam_count == beam_size) {
+        beam_size = beam_size ? beam_size * 2 : 128;
+        beams = realloc(beams, beam_size * sizeof(struct beam));
+        if (beams == NULL) {
+            printf("Failed to add another beam (%d so far).\n", beam_count);
+            exit(1);
+        }
     }
     beams[beam_count].row = row;
     beams[beam_count].col = col;
@@ -177,37 +113,34 @@ next_position(int *row, int *col, direction dir)
 }
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-process_file(FILE *fd)
+solve(struct aoc_input *in)
 {
-    char buf[MAX_LEN + 1];
-
     max_row = 0; max_col = 0;
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
-
-            SHA256((unsigned char *)buf, strlen(buf), digest);
-
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
+    map = calloc(in->count + 1, sizeof(char *));
+    if (map == NULL) {
+        printf("Oops. Failed to allocate the map.\n");
+        exit(1);
+    }
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
 
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        if (!in->lines[lineno].len) {
+            break;
         }
         if (!max_col) {
-            max_col = strlen(buf);
+            max_col = in->lines[lineno].len;
+        } else if (in->lines[lineno].len != max_col) {
+            printf("Oops. Line %zu is not %d long.\n", lineno + 1, max_col);
+            exit(1);
         }
-        strcpy(map[max_row], buf);
+        map[max_row] = buf;
         max_row++;
     }
     if (opts.debug) {
@@ -254,7 +187,7 @@ process_file(FILE *fd)
                        i, cur_row, cur_col, cur_dir);
             }
             next_position(&cur_row, &cur_col, cur_dir);
-            if (cur_row < 0 || cur_row >= max_row || cur_col < 0 || cur_col >= max_row) {
+            if (cur_row < 0 || cur_row >= max_row || cur_col < 0 || cur_col >= max_col) {
                 if (opts.debug) {
                     printf("  Beam %d left the grid.\n", i);
                 }
@@ -264,18 +197,18 @@ process_file(FILE *fd)
             beams[i].row = cur_row;
             beams[i].col = cur_col;
 
-            if (!metadata[cur_row][cur_col].energized) {
-                metadata[cur_row][cur_col].energized = true;
+            if (!metadata[cur_row * max_col + cur_col].energized) {
+                metadata[cur_row * max_col + cur_col].energized = true;
                 energized_total++;
             }
-            if (metadata[cur_row][cur_col].seen[cur_dir]) {
+            if (metadata[cur_row * max_col + cur_col].seen[cur_dir]) {
                 if (opts.debug) {
                     printf("  Beam %d covers a direction/position seen previously\n", i);
                 }
                 beams[i].done = true;
                 continue;
             }
-            metadata[cur_row][cur_col].seen[cur_dir] = true;
+            metadata[cur_row * max_col + cur_col].seen[cur_dir] = true;
             switch (map[cur_row][cur_col]) {
             case '.':
                 if (opts.debug) {
@@ -312,99 +245,11 @@ process_file(FILE *fd)
         }
     }
     printf("Energized spots; %d\n", energized_total);
-}
-
-
-/*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
- */
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
-    }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
-    }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
-    }
-#endif
-}
-
-
-/*
- * Print a minimal usage blurb for the program.
- */
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    free(metadata);
+    free(beams);
+    free(map);
+    metadata = NULL;
+    beams = NULL;
+    map = NULL;
+    beam_size = 0;
 }
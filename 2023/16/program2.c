@@ -5,448 +5,578 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
+# include <stdint.h>     /* uint64_t             */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2023
-# define DAY    16
-# define PART    2
+AOC_PROGRAM(2023, 16, 2);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
 
-# define MAX_LEN 1024
-
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
+typedef enum direction {
+    UP = 0, RIGHT, DOWN, LEFT
+} direction;
 
+direction trans_backslash[4] = { LEFT, DOWN, RIGHT, UP };
+direction trans_slash[4] = { RIGHT, UP, LEFT, DOWN };
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+/* The map rows point into the input */
+int max_row = 0, max_col = 0;
+char **map = NULL;
 
+void
+next_position(int *row, int *col, direction dir)
+{
+    switch (dir) {
+    case UP:    (*row)--; break;
+    case RIGHT: (*col)++; break;
+    case DOWN:  (*row)++; break;
+    case LEFT:  (*col)--; break;
+    }
+}
 
 /*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
+ * A beam only ever changes course at a mirror, or a splitter it hits
+ * on the flat side; everywhere else it goes straight on. So the beams
+ * are followed from one such spot to the next, once: a node of the
+ * graph is a turning spot plus the direction a beam leaves it in, and
+ * its segment the spots the beam goes through until the next turn
+ * (which is included). Node t * 4 + dir leaves turning spot t.
  */
-int
-main(int argc, char *argv[], char *env[])
-{
-    parse_options(&argc, &argv);
+int *turn_at = NULL;    /* Turning spot number per spot, or -1 */
+int *turn_spot = NULL;  /* The spot of each turning spot */
+int turn_total;
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
+struct node {
+    int       row, col;     /* Where the segment starts (not included) */
+    direction dir;
+    int       len;
+    int       next[2];      /* The nodes the beam continues as, or -1 */
+} *nodes = NULL;
+int node_total;
+
+static bool
+is_turn(char c, direction dir)
+{
+    switch (c) {
+    case '/': case '\\':
+        return true;
+    case '|':
+        return dir == LEFT || dir == RIGHT;
+    case '-':
+        return dir == UP || dir == DOWN;
+    case '.':
+        return false;
     }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
+    printf("What character did I miss? %c\n", c);
+    exit(1);
+}
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+/*
+ * Follow a beam from (row, col) in direction dir, to the next spot
+ * where it turns or leaves the grid. Returns the number of spots it
+ * went through, and sets the nodes it continues as.
+ */
+static int
+follow_beam(int row, int col, direction dir, int next[2])
+{
+    int len = 0;
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
+    next[0] = next[1] = -1;
+    for (;;) {
+        next_position(&row, &col, dir);
+        if (row < 0 || row >= max_row || col < 0 || col >= max_col) {
+            return len;
         }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
+        len++;
+        char c = map[row][col];
+        if (!is_turn(c, dir)) {
+            continue;
         }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
+        int turn = turn_at[row * max_col + col] * 4;
+        switch (c) {
+        case '/':
+            next[0] = turn + trans_slash[dir]; break;
+        case '\\':
+            next[0] = turn + trans_backslash[dir]; break;
+        case '|':
+            next[0] = turn + UP;
+            next[1] = turn + DOWN;
+            break;
+        case '-':
+            next[0] = turn + LEFT;
+            next[1] = turn + RIGHT;
+            break;
         }
-        process_file(fd);
-        fclose(fd);
+        return len;
     }
 }
 
+static void
+build_graph()
+{
+    turn_at = malloc((size_t)max_row * max_col * sizeof(int));
+    turn_spot = malloc((size_t)max_row * max_col * sizeof(int));
+    if (turn_at == NULL || turn_spot == NULL) {
+        printf("Oops. Failed to allocate the turning spots.\n");
+        exit(1);
+    }
+    turn_total = 0;
+    for (int row = 0; row < max_row; row++) {
+        for (int col = 0; col < max_col; col++) {
+            int spot = row * max_col + col;
 
-typedef enum direction {
-    UP = 0, RIGHT, DOWN, LEFT
-} direction;
-
-char direction_chars[sizeof(direction)] = {'^', '>', 'v', '<'};
-
-direction trans_backslash[sizeof(direction)] = { LEFT, DOWN, RIGHT, UP };
-direction trans_slash[sizeof(direction)] = { RIGHT, UP, LEFT, DOWN };
-
-int max_row = 0, max_col = 0;
-char map[120][120];
+            turn_at[spot] = -1;
+            if (is_turn(map[row][col], UP) || is_turn(map[row][col], LEFT)) {
+                turn_at[spot] = turn_total;
+                turn_spot[turn_total++] = spot;
+            }
+        }
+    }
+    node_total = turn_total * 4;
+    nodes = malloc((node_total + 1) * sizeof(struct node));
+    if (nodes == NULL) {
+        printf("Oops. Failed to allocate the beam graph.\n");
+        exit(1);
+    }
+    for (int n = 0; n < node_total; n++) {
+        struct node *node = &nodes[n];
 
-struct meta {
-    bool energized  : 1;
-    bool seen[sizeof(direction)];
-} metadata[120][120];
+        node->row = turn_spot[n / 4] / max_col;
+        node->col = turn_spot[n / 4] % max_col;
+        node->dir = n % 4;
+        node->len = follow_beam(node->row, node->col, node->dir, node->next);
+    }
+}
 
-int energized_total;
+/*
+ * Where the beams go around in circles, the nodes all reach each
+ * other: those strongly connected components are found with Tarjan's
+ * algorithm (without recursion), which numbers them such that the
+ * components a component leads to all have a lower number.
+ */
+int *comp_of = NULL;
+int comp_total;
 
-void
-meta_init(int max_row, int max_col)
+static void
+find_components()
 {
-    for (int i = 0; i < max_row; i++) {
-        for (int j = 0; j < max_col; j++) {
-            metadata[i][j].energized   = false;
-            for (int k = 0; k < sizeof(direction); k++) {
-                metadata[i][j].seen[k] = false;
+    int *index = malloc(node_total * sizeof(int));
+    int *low = malloc(node_total * sizeof(int));
+    int *stack = malloc(node_total * sizeof(int));
+    int *call = malloc(node_total * sizeof(int));
+    int *edge = malloc(node_total * sizeof(int));
+    bool *on_stack = calloc(node_total + 1, sizeof(bool));
+
+    comp_of = malloc((node_total + 1) * sizeof(int));
+    if (index == NULL || low == NULL || stack == NULL || call == NULL ||
+        edge == NULL || on_stack == NULL || comp_of == NULL) {
+        printf("Oops. Failed to allocate the component search.\n");
+        exit(1);
+    }
+    for (int n = 0; n < node_total; n++) {
+        index[n] = -1;
+    }
+    int counter = 0, depth = 0, calls = 0;
+    comp_total = 0;
+    for (int root = 0; root < node_total; root++) {
+        if (index[root] != -1) {
+            continue;
+        }
+        call[calls] = root;
+        edge[calls++] = 0;
+        index[root] = low[root] = counter++;
+        stack[depth++] = root;
+        on_stack[root] = true;
+        while (calls > 0) {
+            int n = call[calls - 1];
+
+            if (edge[calls - 1] < 2) {
+                int next = nodes[n].next[edge[calls - 1]++];
+
+                if (next == -1) {
+                    continue;
+                }
+                if (index[next] == -1) {
+                    call[calls] = next;
+                    edge[calls++] = 0;
+                    index[next] = low[next] = counter++;
+                    stack[depth++] = next;
+                    on_stack[next] = true;
+                } else if (on_stack[next] && index[next] < low[n]) {
+                    low[n] = index[next];
+                }
+                continue;
+            }
+            /* Done with n */
+            if (low[n] == index[n]) {
+                int member;
+
+                do {
+                    member = stack[--depth];
+                    on_stack[member] = false;
+                    comp_of[member] = comp_total;
+                } while (member != n);
+                comp_total++;
+            }
+            calls--;
+            if (calls > 0 && low[n] < low[call[calls - 1]]) {
+                low[call[calls - 1]] = low[n];
             }
         }
     }
-    energized_total = 0;
+    free(index);
+    free(low);
+    free(stack);
+    free(call);
+    free(edge);
+    free(on_stack);
 }
 
-# define MAX_BEAMS 100
+/*
+ * Per component: its nodes, and the other components it leads to. The
+ * big loops, with more spots in their segments than there are words in
+ * a bitmap of the whole grid, also get such a bitmap, of every spot the
+ * beams energize from there on (so including the components it leads
+ * to). For the others, going over their segments is less work.
+ */
+int *comp_first = NULL;     /* Nodes comp_nodes[comp_first[c]] .. */
+int *comp_nodes = NULL;
+int *succ_first = NULL;     /* Components comp_succ[succ_first[c]] .. */
+int *comp_succ = NULL;
+uint64_t **comp_bits = NULL;
+int words;
+
+static void
+set_segment(uint64_t *bits, int row, int col, direction dir, int len)
+{
+    for (int i = 0; i < len; i++) {
+        next_position(&row, &col, dir);
 
-struct beam {
-    direction dir;
-    int row;
-    int col;
-    bool done;
-} beams[MAX_BEAMS];
-int beam_count = 0;
+        size_t spot = (size_t)row * max_col + col;
+        bits[spot / 64] |= 1ULL << (spot % 64);
+    }
+}
 
+/*
+ * Going through the components beams get to, with a stack and a mark
+ * for the ones it has seen (and which are on the stack, or done).
+ */
+struct sweeper {
+    uint64_t *bits;
+    int      *seen;
+    int      *stack;
+    int       visit;
+    int       best;         /* Most spots energized from an entry point */
+};
+
+static void
+sweeper_init(struct sweeper *s)
+{
+    s->bits = malloc(words * sizeof(uint64_t));
+    s->seen = calloc(comp_total + 1, sizeof(int));
+    s->stack = malloc((comp_total + 1) * sizeof(int));
+    s->visit = 0;
+    s->best = 0;
+    if (s->bits == NULL || s->seen == NULL || s->stack == NULL) {
+        printf("Oops. Failed to allocate the sweep.\n");
+        exit(1);
+    }
+}
 
-void
-beam_init()
+static void
+sweeper_free(struct sweeper *s)
 {
-    beam_count = 0;
+    free(s->bits);
+    free(s->seen);
+    free(s->stack);
 }
 
-void
-beam_add(int row, int col, direction dir)
+static inline void
+sweep_push(struct sweeper *s, int *depth, int c)
 {
-    if (beam_count == MAX_BEAMS) {
-        printf("Failed to add another beam. Increase the max (currently %d)\n", MAX_BEAMS);
-        exit(1);
+    if (s->seen[c] != s->visit) {
+        s->seen[c] = s->visit;
+        s->stack[(*depth)++] = c;
     }
-    beams[beam_count].row = row;
-    beams[beam_count].col = col;
-    beams[beam_count].dir = dir;
-    beams[beam_count].done = false;
-    beam_count++;
 }
 
-void
-beam_compact()
+/*
+ * OR into bits every spot energized from the components on the stack
+ * onwards. Components with a bitmap have all of that in there, so
+ * there's no need to go beyond those.
+ */
+static void
+sweep(struct sweeper *s, uint64_t *bits, int depth)
 {
-    int target = 0;
-    for (int i = 0; i < beam_count; i++) {
-        if (beams[i].done) {
+    while (depth > 0) {
+        int c = s->stack[--depth];
+
+        if (comp_bits[c] != NULL) {
+            for (int w = 0; w < words; w++) {
+                bits[w] |= comp_bits[c][w];
+            }
             continue;
         }
-        if (i == target) {
-            target++;
-            continue;
+        for (int i = comp_first[c]; i < comp_first[c + 1]; i++) {
+            struct node *node = &nodes[comp_nodes[i]];
+
+            set_segment(bits, node->row, node->col, node->dir, node->len);
+        }
+        for (int i = succ_first[c]; i < succ_first[c + 1]; i++) {
+            sweep_push(s, &depth, comp_succ[i]);
         }
-        beams[target].dir = beams[i].dir;
-        beams[target].row = beams[i].row;
-        beams[target].col = beams[i].col;
-        beams[target].done = false;
-        target++;
     }
-    beam_count = target;
 }
 
-void
-next_position(int *row, int *col, direction dir)
+static void
+condense_graph()
 {
-    switch (dir) {
-    case UP:    (*row)--; break;
-    case RIGHT: (*col)++; break;
-    case DOWN:  (*row)++; break;
-    case LEFT:  (*col)--; break;
+    comp_first = calloc(comp_total + 1, sizeof(int));
+    comp_nodes = malloc((node_total + 1) * sizeof(int));
+    succ_first = calloc(comp_total + 1, sizeof(int));
+    comp_succ = malloc((2 * node_total + 1) * sizeof(int));
+    comp_bits = calloc(comp_total + 1, sizeof(uint64_t *));
+    int *seen = malloc((comp_total + 1) * sizeof(int));
+    if (comp_first == NULL || comp_nodes == NULL || succ_first == NULL ||
+        comp_succ == NULL || comp_bits == NULL || seen == NULL) {
+        printf("Oops. Failed to allocate the components.\n");
+        exit(1);
+    }
+    for (int n = 0; n < node_total; n++) {
+        comp_first[comp_of[n] + 1]++;
+    }
+    for (int c = 0; c < comp_total; c++) {
+        comp_first[c + 1] += comp_first[c];
+    }
+    /* Bucket the nodes by component, using seen[] for where the next one goes */
+    memcpy(seen, comp_first, comp_total * sizeof(int));
+    for (int n = 0; n < node_total; n++) {
+        comp_nodes[seen[comp_of[n]]++] = n;
     }
-}
-
-int
-calc_energized_total(int row, int col, direction dir)
-{
-    /*
-     * Now the show begins
-     */
-    int round = 0;
-
-    meta_init(max_row, max_col);
 
-    beam_init();
-    /* Starting position and direction of the first and only beam */
-    beam_add(row, col, dir);
+    int succ_total = 0;
+    for (int c = 0; c < comp_total; c++) {
+        seen[c] = -1;
+    }
+    for (int c = 0; c < comp_total; c++) {
+        long len = 0;
 
-    while (true) {
-        round++;
+        succ_first[c] = succ_total;
+        for (int i = comp_first[c]; i < comp_first[c + 1]; i++) {
+            struct node *node = &nodes[comp_nodes[i]];
 
-        /* Compacting the list of beams */
-        beam_compact();
-        if (beam_count == 0) {
-            break;
-        }
-        if (opts.debug) {
-            printf("Round %d - %d beams, %d squares energized\n",
-                   round, beam_count, energized_total);
-            for (int i = 0; i < max_row; i++) {
-                printf("  %s\n", map[i]);
+            len += node->len;
+            for (int e = 0; e < 2; e++) {
+                if (node->next[e] == -1) {
+                    continue;
+                }
+                int next = comp_of[node->next[e]];
+                if (next != c && seen[next] != c) {
+                    seen[next] = c;
+                    comp_succ[succ_total++] = next;
+                }
             }
-            printf("\n");
         }
-        for (int i = beam_count - 1; i >= 0; i--) {
-            if (beams[i].done) {
-                continue;
+        if (len > words) {
+            comp_bits[c] = calloc(words, sizeof(uint64_t));
+            if (comp_bits[c] == NULL) {
+                printf("Oops. Failed to allocate a component bitmap.\n");
+                exit(1);
             }
-            int cur_row = beams[i].row;
-            int cur_col = beams[i].col;
-            direction cur_dir = beams[i].dir;
+            for (int i = comp_first[c]; i < comp_first[c + 1]; i++) {
+                struct node *node = &nodes[comp_nodes[i]];
 
-            if (opts.debug) {
-                printf("  Beam %d at (%d,%d) - %d\n",
-                       i, cur_row, cur_col, cur_dir);
+                set_segment(comp_bits[c], node->row, node->col, node->dir, node->len);
             }
-            next_position(&cur_row, &cur_col, cur_dir);
-            if (cur_row < 0 || cur_row >= max_row || cur_col < 0 || cur_col >= max_row) {
-                if (opts.debug) {
-                    printf("  Beam %d left the grid.\n", i);
-                }
-                beams[i].done = true;
-                continue;
-            }
-            beams[i].row = cur_row;
-            beams[i].col = cur_col;
+        }
+    }
+    succ_first[comp_total] = succ_total;
+    free(seen);
 
-            if (!metadata[cur_row][cur_col].energized) {
-                metadata[cur_row][cur_col].energized = true;
-                energized_total++;
-            }
-            if (metadata[cur_row][cur_col].seen[cur_dir]) {
-                if (opts.debug) {
-                    printf("  Beam %d covers a direction/position seen previously\n", i);
-                }
-                beams[i].done = true;
-                continue;
-            }
-            metadata[cur_row][cur_col].seen[cur_dir] = true;
-            switch (map[cur_row][cur_col]) {
-            case '.':
-                if (opts.debug) {
-                    map[cur_row][cur_col] = direction_chars[cur_dir];
-                }
-                break;
-            case '>': case '<': case 'v': case '^':
-                break; /* Originally '.' */
-            case '|':
-                if (cur_dir == LEFT || cur_dir == RIGHT) {
-                    /* Split into an up and down beam */
-                    beams[i].dir = UP;
-
-                    beam_add(cur_row, cur_col, DOWN);
-                }
-                break;
-            case '-':
-                if (cur_dir == UP || cur_dir == DOWN) {
-                    /* Split into a left and right beam */
-                    beams[i].dir = LEFT;
+    /*
+     * Add what the big loops lead to, the ones that lead nowhere else
+     * first: the components a component leads to have lower numbers.
+     */
+    struct sweeper s;
+    sweeper_init(&s);
+    for (int c = 0; c < comp_total; c++) {
+        int depth = 0;
 
-                    beam_add(cur_row, cur_col, RIGHT);
-                }
-                break;
-            case '\\':
-                beams[i].dir = trans_backslash[cur_dir]; break;
-            case '/':
-                beams[i].dir = trans_slash[cur_dir]; break;
-            default:
-                printf("What character did I miss? %c at (%d,%d)\n",
-                       map[cur_row][cur_col], cur_row, cur_col);
-                exit(1);
-            }
+        if (comp_bits[c] == NULL) {
+            continue;
         }
+        s.visit++;
+        for (int i = succ_first[c]; i < succ_first[c + 1]; i++) {
+            sweep_push(&s, &depth, comp_succ[i]);
+        }
+        sweep(&s, comp_bits[c], depth);
     }
-    if (opts.debug) {
-        printf("Energized spots; %d\n", energized_total);
-    }
-    return energized_total;
+    sweeper_free(&s);
 }
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * For an entry point, the spots energized are the ones on the way in,
+ * plus those of every component that can be reached from there.
  */
-void
-process_file(FILE *fd)
+static int
+calc_energized_total(struct sweeper *s, int row, int col, direction dir)
 {
-    char buf[MAX_LEN + 1];
-
-    max_row = 0; max_col = 0;
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
+    int next[2], depth = 0;
+
+    memset(s->bits, 0, words * sizeof(uint64_t));
+    s->visit++;
+    set_segment(s->bits, row, col, dir, follow_beam(row, col, dir, next));
+    for (int e = 0; e < 2; e++) {
+        if (next[e] != -1) {
+            sweep_push(s, &depth, comp_of[next[e]]);
         }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
+    }
+    sweep(s, s->bits, depth);
+    int total = 0;
+    for (int w = 0; w < words; w++) {
+        total += __builtin_popcountll(s->bits[w]);
+    }
+    if (opts.debug) {
+        printf("Total when starting from (%d,%d): %d\n", row, col, total);
+    }
+    return total;
+}
 
-            SHA256((unsigned char *)buf, strlen(buf), digest);
+/*
+ * The entry points (left and right of every row, above and below every
+ * column) are handed out to the threads in chunks, each thread with a
+ * sweeper of its own.
+ */
+# define CHUNK 16
 
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
+int max_total;
 
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
-        }
-        if (!max_col) {
-            max_col = strlen(buf);
-        }
-        strcpy(map[max_row], buf);
-        max_row++;
-    }
-    if (opts.debug) {
-        printf("DEBUG: End of file\n");
+static void *
+entries_init()
+{
+    struct sweeper *s = malloc(sizeof(struct sweeper));
+
+    if (s == NULL) {
+        printf("Oops. Failed to allocate the sweep.\n");
+        exit(1);
     }
+    sweeper_init(s);
+    return s;
+}
 
-    int max_total = 0;
-    for (int row = 0; row < max_row; row++) {
-        int total = calc_energized_total(row, -1, RIGHT);
-        if (opts.debug) {
-            printf("Total when starting from (%d,%d): %d\n", row, -1, total);
-        }
-        if (total > max_total) {
-            max_total = total;
-        }
-        total = calc_energized_total(row, max_col, LEFT);
-        if (opts.debug) {
-            printf("Total when starting from (%d,%d): %d\n", row, max_col, total);
+static bool
+sweep_entries(void *scratch, long from, long to)
+{
+    struct sweeper *s = scratch;
+
+    for (long e = from; e < to; e++) {
+        int total;
+
+        if (e < max_row) {
+            total = calc_energized_total(s, e, -1, RIGHT);
+        } else if (e < 2 * max_row) {
+            total = calc_energized_total(s, e - max_row, max_col, LEFT);
+        } else if (e < 2 * max_row + max_col) {
+            total = calc_energized_total(s, -1, e - 2 * max_row, DOWN);
+        } else {
+            total = calc_energized_total(s, max_row, e - 2 * max_row - max_col, UP);
         }
-        if (total > max_total) {
-            max_total = total;
+        if (total > s->best) {
+            s->best = total;
         }
     }
-    for (int col = 0; col < max_col; col++) {
-        int total = calc_energized_total(-1, col, DOWN);
-        if (opts.debug) {
-            printf("Total when starting from (%d,%d): %d\n", -1, col, total);
-        }
-        if (total > max_total) {
-            max_total = total;
-        }
-        total = calc_energized_total(max_row, col, UP);
-        if (opts.debug) {
-            printf("Total when starting from (%d,%d): %d\n", max_row, col, total);
-        }
-        if (total > max_total) {
-            max_total = total;
-        }
+    return true;
+}
+
+static void
+entries_reduce(void *scratch)
+{
+    struct sweeper *s = scratch;
+
+    if (s->best > max_total) {
+        max_total = s->best;
     }
-    printf("Maximum energized spots; %d\n", max_total);
 }
 
+static void
+entries_fini(void *scratch)
+{
+    sweeper_free(scratch);
+    free(scratch);
+}
 
 /*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-parse_options(int *argc, char **argv[])
+solve(struct aoc_input *in)
 {
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
+    max_row = 0; max_col = 0;
+    map = calloc(in->count + 1, sizeof(char *));
+    if (map == NULL) {
+        printf("Oops. Failed to allocate the map.\n");
+        exit(1);
     }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
+
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        if (!in->lines[lineno].len) {
             break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
         }
+        if (!max_col) {
+            max_col = in->lines[lineno].len;
+        } else if (in->lines[lineno].len != max_col) {
+            printf("Oops. Line %zu is not %d long.\n", lineno + 1, max_col);
+            exit(1);
+        }
+        map[max_row] = buf;
+        max_row++;
+    }
+    if (opts.debug) {
+        printf("DEBUG: End of file\n");
     }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
+    if (max_row == 0) {
+        printf("Oops. No contraption found.\n");
+        exit(1);
     }
-#endif
-}
+    words = ((size_t)max_row * max_col + 63) / 64;
 
+    build_graph();
+    find_components();
+    condense_graph();
+    if (opts.verbose) {
+        printf("%d beam segments in %d components.\n", node_total, comp_total);
+    }
 
-/*
- * Print a minimal usage blurb for the program.
- */
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    max_total = 0;
+    aoc_parallel_for(2 * (max_row + max_col), CHUNK,
+                     entries_init, sweep_entries, entries_reduce, entries_fini);
+    printf("Maximum energized spots; %d\n", max_total);
+
+    for (int c = 0; c < comp_total; c++) {
+        free(comp_bits[c]);
+    }
+    free(comp_bits);
+    free(comp_first);
+    free(comp_nodes);
+    free(succ_first);
+    free(comp_succ);
+    free(comp_of);
+    free(nodes);
+    free(turn_at);
+    free(turn_spot);
+    free(map);
+    comp_bits = NULL;
+    comp_first = comp_nodes = succ_first = comp_succ = comp_of = NULL;
+    nodes = NULL;
+    turn_at = turn_spot = NULL;
+    map = NULL;
 }
@@ -5,90 +5,74 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
+# include <limits.h>     /* INT_MAX              */
 # include <stdbool.h>    /* bool, true, false    */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2023
-# define DAY    17
-# define PART    2
+AOC_PROGRAM(2023, 17, 2);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
+/* How far the crucible has to/can go in one direction */
+# define MIN_RUN 4
+# define MAX_RUN 10
 
-# define MAX_LEN 1024
-
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
 
+typedef enum direction {
+    UP, RIGHT, DOWN, LEFT
+} direction;
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+# define DIRECTIONS 4
 
+int max_row = 0, max_col = 0;
+char **map = NULL;
 
 /*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
+ * The search space: every (row, col, direction, run length) the
+ * crucible can be in is a state, numbered as below. The direction is
+ * the one it moved in to get there, and the run length is how many
+ * steps it has taken in that direction (1 .. max_run).
  */
-int
-main(int argc, char *argv[], char *env[])
+int *state_loss = NULL;
+int *state_prev = NULL;
+
+static inline int
+state_index(int row, int col, direction dir, int run, int max_run)
 {
-    parse_options(&argc, &argv);
+    return ((row * max_col + col) * DIRECTIONS + dir) * max_run + run - 1;
+}
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
-    }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
+/*
+ * All edge weights are single digits, so a bucket (Dial's) queue will
+ * do instead of a heap: states are filed under their loss, modulo the
+ * number of buckets, and since a state is never more than 9 away from
+ * the one being expanded, 10 buckets are enough to never mix up two
+ * different losses.
+ */
+# define BUCKETS 10
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+struct bucket {
+    int *states;
+    int  count;
+    int  size;
+} buckets[BUCKETS];
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
+void
+bucket_push(struct bucket *b, int state)
+{
+    if (b->count == b->size) {
+        b->size = b->size ? b->size * 2 : 1024;
+        b->states = realloc(b->states, b->size * sizeof(int));
+        if (b->states == NULL) {
+            printf("Oops. Failed to grow a bucket to %d states.\n", b->size);
+            exit(1);
         }
-        process_file(fd);
-        fclose(fd);
     }
+    b->states[b->count++] = state;
 }
 
-typedef enum direction {
-    UP, RIGHT, DOWN, LEFT
-} direction;
-
-
-int max_row = 0, max_col = 0;
-char map[150][150];
-int min_loss = 0;
-int min_dir_loss[150][150][sizeof(direction) * 11];
-
 void
 next_position(int row, int col, direction dir, int *next_row, int *next_col) {
     *next_row = row;
@@ -102,275 +86,197 @@ next_position(int row, int col, direction dir, int *next_row, int *next_col) {
     }
 }
 
-# define MAX_TRACE 10000
-
+/*
+ * Try moving (from a state with the given loss) in direction d, and
+ * queue the state that ends up in if that is an improvement.
+ */
 void
-show_trace(int trace[MAX_TRACE], int count)
+relax(int from, int loss, int row, int col, direction d, int run, int max_run)
 {
-    char copy[150][150];
-    char border[152];
+    int next_row, next_col;
 
-    border[0] = '+';
-    border[max_col + 1] = '+';
-    for (int col = 0; col < max_col; col++) {
-        border[col + 1] = '-';
+    next_position(row, col, d, &next_row, &next_col);
+    if (next_row < 0 || next_col < 0 || next_row == max_row || next_col == max_col) {
+        return;
+    }
+    int new_loss = loss + map[next_row][next_col] - '0';
+    int next = state_index(next_row, next_col, d, run, max_run);
+    if (new_loss >= state_loss[next]) {
+        return;
     }
-    border[max_col + 2] = '\0';
+    state_loss[next] = new_loss;
+    if (state_prev != NULL) {
+        state_prev[next] = from;
+    }
+    bucket_push(&buckets[new_loss % BUCKETS], next);
+}
+
+void
+show_trace(int state, int max_run)
+{
+    char *copy[max_row];
+
     for (int row = 0; row < max_row; row++) {
-        strcpy(copy[row], map[row]);
+        copy[row] = strdup(map[row]);
+    }
+    for (; state >= 0; state = state_prev[state]) {
+        int cell = state / max_run / DIRECTIONS;
+
+        copy[cell / max_col][cell % max_col] = ' ';
     }
-    for (int i = 0; i < count; i++) {
-        int t_row = trace[i] / max_col;
-        int t_col = trace[i] % max_col;
-        copy[t_row][t_col] = ' ';
+    copy[0][0] = ' ';
+    printf("+");
+    for (int col = 0; col < max_col; col++) {
+        printf("-");
     }
-    copy[max_row - 1][max_col -1] = ' ';
-    printf("%s\n", border);
+    printf("+\n");
     for (int row = 0; row < max_row; row++) {
         printf("|%s|\n", copy[row]);
+        free(copy[row]);
+    }
+    printf("+");
+    for (int col = 0; col < max_col; col++) {
+        printf("-");
     }
-    printf("%s\n", border);
+    printf("+\n");
 }
 
-void
-find_loss(int loss, int row, int col, direction dir, int repeats, int trace[MAX_TRACE], int count)
+/*
+ * Dijkstra over the states, from the top left to the bottom right,
+ * where the crucible has to move at least min_run and at most max_run
+ * steps in one direction before turning (or stopping).
+ */
+int
+find_loss(int min_run, int max_run)
 {
-    if (opts.debug) {
-        printf("find_loss(%d, %d, %d, %d, %d)\n", loss, row, col, dir, repeats);
+    size_t states = (size_t)max_row * max_col * DIRECTIONS * max_run;
+    int queued = 0;
+
+    if (max_row == 1 && max_col == 1) {
+        return 0;
     }
-    if (min_loss > 0 && loss > min_loss) {
-        /* No point continuing */
-        return;
+    state_loss = malloc(states * sizeof(int));
+    if (state_loss == NULL) {
+        printf("Oops. Failed to allocate %zu states.\n", states);
+        exit(1);
     }
-    /* Try all directions */
-    for (int d = 0; d < sizeof(direction); d++) {
-        int next_row, next_col;
-
-        if (dir == d + 2 || d == dir + 2) {
-            if (opts.debug) {
-                printf("Can't reverse (current dir %d, possible dir %d)\n", dir, d);
-            }
-            continue;
+    for (size_t i = 0; i < states; i++) {
+        state_loss[i] = INT_MAX;
+    }
+    if (opts.verbose) {
+        state_prev = malloc(states * sizeof(int));
+        if (state_prev == NULL) {
+            printf("Oops. Failed to allocate %zu states.\n", states);
+            exit(1);
         }
-        if (repeats < 4 && dir != d) {
-            if (opts.debug) {
-                printf("Can't turn yet.\n");
+    }
+
+    /* There's no direction at the start, so it can go either way */
+    relax(-1, 0, 0, 0, RIGHT, 1, max_run);
+    relax(-1, 0, 0, 0, DOWN, 1, max_run);
+
+    int result = -1;
+    for (int loss = 0; result < 0; loss++) {
+        struct bucket *b = &buckets[loss % BUCKETS];
+
+        /* Give up once all buckets have been seen empty in a row */
+        if (b->count == 0) {
+            if (++queued > BUCKETS) {
+                break;
             }
             continue;
         }
-        if (dir == d && repeats == 10) {
-            if (opts.debug) {
-                printf("Can't go another step in that direction (%d)\n", dir);
+        queued = 0;
+        /* Expanding may add to this very bucket (but not at this loss) */
+        for (int i = 0; i < b->count; i++) {
+            int state = b->states[i];
+
+            if (state_loss[state] != loss) {
+                /* Found a better way there since it was queued */
+                continue;
             }
-            continue;
-        }
-        next_position(row, col, d, &next_row, &next_col);
-        if (next_row < 0 || next_col < 0 || next_row == max_row || next_col == max_col) {
+            int run = state % max_run + 1;
+            direction dir = state / max_run % DIRECTIONS;
+            int cell = state / max_run / DIRECTIONS;
+            int row = cell / max_col, col = cell % max_col;
+
             if (opts.debug) {
-                printf("That would take us off the board (%d, %d)\n", next_row, next_col);
+                printf("Expanding (%d,%d) dir %d run %d with loss %d\n", row, col, dir, run, loss);
             }
-            continue;
-        }
-        int new_loss = loss + map[next_row][next_col] - '0';
-        if (next_row == max_row - 1 && next_col == max_col - 1) {
-            if (min_loss == 0 || new_loss < min_loss) {
-                min_loss = new_loss;
+            if (row == max_row - 1 && col == max_col - 1 && run >= min_run) {
+                result = loss;
                 if (opts.verbose) {
-                    printf("Reached the destination with loss %d\n", new_loss);
-                    if (opts.debug) {
-                        printf("TRACE: ");
-                        for (int i = 0; i < count; i++) {
-                            int t_row = trace[i] / max_col;
-                            int t_col = trace[i] % max_col;
-                            printf(" (%d,%d)", t_row, t_col);
-                        }
-                    }
-                    show_trace(trace, count);
+                    printf("Reached the destination with loss %d\n", loss);
+                    show_trace(state, max_run);
                     printf("\n");
                 }
+                break;
             }
-            continue;
-        }
-        int dir_loss;
-        if (dir == d) {
-            dir_loss = repeats * sizeof(direction) + d;
-        } else {
-            dir_loss = d;
-        }
-        if (min_dir_loss[next_row][next_col][dir_loss] > 0 && new_loss >= min_dir_loss[next_row][next_col][dir_loss]) {
-            if (opts.debug) {
-                printf("This is equal or worse than an earlier attempt, for (%d,%d) %d.\n",
-                       next_row, next_col, dir_loss);
+            if (run < max_run) {
+                relax(state, loss, row, col, dir, run + 1, max_run);
             }
-            continue;
-        }
-        min_dir_loss[next_row][next_col][dir_loss] = new_loss;
-        int new_trace = next_row * max_col + next_col;
-        if (count == MAX_TRACE) {
-            printf("Oops. Need to increase the trace size.\n");
-            exit(1);
-        }
-        trace[count] = new_trace;
-        bool found = false;
-        for (int i = 0; i < count; i++ ) {
-            if (trace[i] == new_trace) {
-                found = true;
+            if (run >= min_run) {
+                /* Turn left or right */
+                relax(state, loss, row, col, (dir + 1) % DIRECTIONS, 1, max_run);
+                relax(state, loss, row, col, (dir + 3) % DIRECTIONS, 1, max_run);
             }
         }
-        if (found) {
-            continue;
-        }
-        if (dir == d) {
-            find_loss(new_loss, next_row, next_col, d, repeats + 1, trace, count + 1);
-        } else {
-            find_loss(new_loss, next_row, next_col, d, 1, trace, count + 1);
-        }
+        b->count = 0;
     }
+    for (int i = 0; i < BUCKETS; i++) {
+        buckets[i].count = 0;
+    }
+    free(state_loss);
+    free(state_prev);
+    state_loss = NULL;
+    state_prev = NULL;
+    return result;
 }
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-process_file(FILE *fd)
+solve(struct aoc_input *in)
 {
-    char buf[MAX_LEN + 1];
-
     max_row = 0; max_col = 0;
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
-
-            SHA256((unsigned char *)buf, strlen(buf), digest);
-
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
+    map = calloc(in->count + 1, sizeof(char *));
+    if (map == NULL) {
+        printf("Oops. Failed to allocate the map.\n");
+        exit(1);
+    }
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
 
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        if (in->lines[lineno].len == 0) {
+            break;
         }
         if (!max_col) {
-            max_col = strlen(buf);
+            max_col = in->lines[lineno].len;
+        } else if (in->lines[lineno].len != max_col) {
+            printf("Oops. Line %zu is not %d long.\n", lineno + 1, max_col);
+            exit(1);
         }
-        strcpy(map[max_row], buf);
+        map[max_row] = buf;
         max_row++;
     }
     if (opts.debug) {
         printf("DEBUG: End of file\n");
     }
-    min_loss = 0;
-    for (int row = 0; row < max_row; row++) {
-        for (int col = 0; col < max_col; col++) {
-            for (int i = 0; i < sizeof(direction) * 10; i++) {
-                min_dir_loss[row][col][i] = 0;
-            }
-        }
-    }
-    int trace[MAX_TRACE];
-    trace[0] = 0;
-    find_loss(0, 0, 0, RIGHT, 0, trace, 1);
-    find_loss(0, 0, 0, DOWN, 0, trace, 1);
-    printf("Minimum heat loss found: %d\n", min_loss);
-}
-
-
-/*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
- */
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
-    }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
-    }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
-    }
-#endif
-}
-
-
-/*
- * Print a minimal usage blurb for the program.
- */
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
+    if (max_row == 0) {
+        printf("Oops. No map found.\n");
+        exit(1);
     }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
+    int min_loss = find_loss(MIN_RUN, MAX_RUN);
+    if (min_loss < 0) {
+        printf("There is no way to reach the destination.\n");
+    } else {
+        printf("Minimum heat loss found: %d\n", min_loss);
     }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    free(map);
+    map = NULL;
 }
@@ -5,388 +5,344 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2023
-# define DAY    19
-# define PART    1
+AOC_PROGRAM(2023, 19, 1);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
 
-# define MAX_LEN 1024
+typedef enum names {
+    NAME_X,
+    NAME_M,
+    NAME_A,
+    NAME_S
+} name;
+
+/*
+ * The workflows get compiled into a decision tree: every rule is a
+ * node, which sends a part on to the node in yes[] when the test
+ * passes, and to the one in no[] (the next rule, or the fallback) if
+ * not. Nodes point at other nodes directly, or at one of these:
+ */
+# define WORKFLOW_A -1
+# define WORKFLOW_R -2
 
 struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
+    int   total;
+    name *attr;
+    char *op;
+    int  *value;
+    int  *yes;
+    int  *no;
+} nodes;
 
+/*
+ * The workflows as found in the input, with their names interned in an
+ * open addressing table (of twice the size, at least).
+ */
+struct workflow {
+    char *name;
+    char *rules;
+    int   count;
+    int   first;
+    char *fallback;
+    int   entry;
+};
+
+struct workflow *workflows = NULL;
+int count = 0;
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+int *names = NULL;
+int names_size;
 
+unsigned int
+hash_name(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    for (; *name; name++) {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+    return hash;
+}
 
 /*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
+ * Returns the name's slot in the table: either the one with the name,
+ * or the empty one it would go into.
  */
 int
-main(int argc, char *argv[], char *env[])
+name_slot(const char *name)
 {
-    parse_options(&argc, &argv);
+    int slot = hash_name(name) & (names_size - 1);
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
-    }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
-
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
-
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
-        }
-        process_file(fd);
-        fclose(fd);
+    while (names[slot] != -1 && strcmp(workflows[names[slot]].name, name)) {
+        slot = (slot + 1) & (names_size - 1);
     }
+    return slot;
 }
 
-typedef enum names {
-    NAME_X,
-    NAME_M,
-    NAME_A,
-    NAME_S
-} name;
-
-typedef struct rule {
-    name attr;
-    char op;
-    int  value;
-    char target[5];
-} rule;
-
-typedef struct workflow {
-    char name[5];
-    rule rules[5];
-    int  count;
-    char fallback[5];
-} workflow;
-
-workflow workflows[600];
-
-int count = 0;
-
-
-bool
-process_workflows(int flow, int attr[4])
+/*
+ * Where a part goes when it's sent to the named workflow
+ */
+int
+find_target(const char *name, int depth)
 {
-    if (opts.debug) {
-        printf("process_workflows(%d, %d, %d, %d)\n",
-               attr[0], attr[1], attr[2], attr[3]);
+    if (!strcmp(name, "A")) {
+        return WORKFLOW_A;
     }
-    while (true) {
-        char *next = NULL;
-
-        if (opts.debug) {
-            printf("Checking against workflow %d\n", flow);
-        }
-        for (int r = 0; r < workflows[flow].count; r++) {
-            if (opts.debug) {
-                printf("  Checking against rule %d: %d %c %d (attr[%d] = %d)\n",
-                       r,
-                       workflows[flow].rules[r].attr,
-                       workflows[flow].rules[r].op,
-                       workflows[flow].rules[r].value,
-                       workflows[flow].rules[r].attr,
-                       attr[workflows[flow].rules[r].attr]);
-            }
-            switch (workflows[flow].rules[r].op) {
-            case '<':
-                if (attr[workflows[flow].rules[r].attr] < workflows[flow].rules[r].value) {
-                    next = workflows[flow].rules[r].target;
-                }
-                break;
-            case '>':
-                if (attr[workflows[flow].rules[r].attr] > workflows[flow].rules[r].value) {
-                    next = workflows[flow].rules[r].target;
-                }
-                break;
-            default:
-                printf("What operator is this? %c\n", workflows[flow].rules[r].op);
-                exit(1);
-            }
-            if (NULL != next) {
-                break; /* for */
-            }
-        }
-        if (NULL == next) {
-            next = workflows[flow].fallback;
-        }
-        if (!strcmp(next, "A")) {
-            return true;
-        }
-        if (!strcmp(next, "R")) {
-            return false;
-        }
-        for (int w = 0; w < count; w++) {
-            if (!strcmp(workflows[w].name, next)) {
-                if (opts.debug) {
-                    printf("Moving on to %s (%d)\n", next, w);
-                }
-                flow = w;
-                break;
-            }
-        }
+    if (!strcmp(name, "R")) {
+        return WORKFLOW_R;
     }
-    return false;
+    int w = names[name_slot(name)];
+    if (w == -1) {
+        printf("Could not find the workflow for %s?\n", name);
+        exit(1);
+    }
+    if (workflows[w].count > 0) {
+        return workflows[w].first;
+    }
+    /* Without any rules, it's the same as where it falls back to */
+    if (depth > count) {
+        printf("Oops. The workflows loop around at %s.\n", name);
+        exit(1);
+    }
+    return find_target(workflows[w].fallback, depth + 1);
 }
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * Go through the lines with workflows, and compile them. Returns the
+ * number of lines used (including the empty one after them).
  */
-void
-process_file(FILE *fd)
+size_t
+compile_workflows(struct aoc_input *in)
 {
-    char buf[MAX_LEN + 1];
-    int total = 0;
+    size_t lineno;
 
+    workflows = malloc((in->count + 1) * sizeof(struct workflow));
+    if (workflows == NULL) {
+        printf("Oops. Failed to allocate the workflows.\n");
+        exit(1);
+    }
     count = 0;
+    nodes.total = 0;
+    for (lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
 
-    /* Parse workflows */
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
         if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
-
-            SHA256((unsigned char *)buf, strlen(buf), digest);
-
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
-
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
+            printf("DEBUG: Line received: '%s'\n", buf);
         }
-        if (!strlen(buf)) {
+        if (!in->lines[lineno].len) {
             break;
         }
-        char name[5];
-        char info[MAX_LEN + 1];
-        sscanf(buf, "%[a-z]{%[^}]}", name, info);
-
-        strcpy(workflows[count].name, name);
-        workflows[count].count = 0;
-
-        int total = 0;
-        char *p = info;
-        while (true) {
-            char *sep = strchr(p, ',');
-            if (NULL == sep) {
-                if (opts.debug) {
-                    printf("  Fallback: %s\n", p);
-                }
-                strcpy(workflows[count].fallback, p);
-                break;
-            }
-            sep[0] = '\0';
-            char attr, op;
-            int value;
-            char target[5];
-            sscanf(p, "%c%c%d:%s", &attr, &op, &value, target);
-            switch (attr) {
-            case 'x': workflows[count].rules[total].attr = NAME_X; break;
-            case 'm': workflows[count].rules[total].attr = NAME_M; break;
-            case 'a': workflows[count].rules[total].attr = NAME_A; break;
-            case 's': workflows[count].rules[total].attr = NAME_S; break;
-            }
-            workflows[count].rules[total].op = op;
-            workflows[count].rules[total].value = value;
-            strcpy(workflows[count].rules[total].target, target);
-            if (opts.debug) {
-                printf("  Rule: %c %c %d => %s\n", attr, op, value, target);
-            }
-            total++;
-            p = sep + 1;
+        /* name{rule,rule,...,fallback} */
+        char *rules = strchr(buf, '{');
+        char *end = strchr(buf, '}');
+        if (rules == NULL || end == NULL) {
+            printf("Oops. Can't make sense of workflow '%s'.\n", buf);
+            exit(1);
         }
-        workflows[count].count = total;
-        if (opts.debug) {
-            printf("Total of %d rules\n", total);
+        *rules++ = '\0';
+        *end = '\0';
+
+        struct workflow *flow = &workflows[count];
+        flow->name = buf;
+        flow->rules = rules;
+        flow->count = 0;
+        for (char *p = rules; *p; p++) {
+            if (*p == ',') {
+                flow->count++;
+            }
         }
+        flow->first = nodes.total;
+        nodes.total += flow->count;
         count++;
     }
     if (opts.debug) {
-        printf("Found a total of %d workflows\n", count);
+        printf("Found a total of %d workflows, with %d rules\n", count, nodes.total);
     }
 
-    int flow_start = 0;
-    for (int w = 0; w < count; w++) {
-        if (!strcmp(workflows[w].name, "in")) {
-            flow_start = w;
-            break;
-        }
+    for (names_size = 1024; names_size < count * 2; names_size *= 2) {
+        /* Just finding the size */
     }
-    if (opts.debug) {
-        printf("Workflow to start at: %d\n", flow_start);
-        printf("\n");
+    names = malloc(names_size * sizeof(int));
+    nodes.attr = malloc((nodes.total + 1) * sizeof(name));
+    nodes.op = malloc(nodes.total + 1);
+    nodes.value = malloc((nodes.total + 1) * sizeof(int));
+    nodes.yes = malloc((nodes.total + 1) * sizeof(int));
+    nodes.no = malloc((nodes.total + 1) * sizeof(int));
+    if (names == NULL || nodes.attr == NULL || nodes.op == NULL || nodes.value == NULL ||
+        nodes.yes == NULL || nodes.no == NULL) {
+        printf("Oops. Failed to allocate the decision tree.\n");
+        exit(1);
     }
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
+    for (int i = 0; i < names_size; i++) {
+        names[i] = -1;
+    }
+    for (int w = 0; w < count; w++) {
+        int slot = name_slot(workflows[w].name);
+
+        if (names[slot] != -1) {
+            printf("Oops. Workflow %s is there twice.\n", workflows[w].name);
+            exit(1);
         }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
+        names[slot] = w;
+    }
 
-            SHA256((unsigned char *)buf, strlen(buf), digest);
+    /* Split up the rules, terminating the target names in place */
+    for (int w = 0; w < count; w++) {
+        char *p = workflows[w].rules;
 
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
+        for (int r = 0; r < workflows[w].count; r++) {
+            char *sep = strchr(p, ',');
+            char *colon = strchr(p, ':');
+            int n = workflows[w].first + r;
 
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
+            if (colon == NULL || colon > sep || (p[1] != '<' && p[1] != '>')) {
+                printf("Oops. Can't make sense of rule '%.*s'.\n", (int)(sep - p), p);
+                exit(1);
+            }
+            *sep = '\0';
+            switch (p[0]) {
+            case 'x': nodes.attr[n] = NAME_X; break;
+            case 'm': nodes.attr[n] = NAME_M; break;
+            case 'a': nodes.attr[n] = NAME_A; break;
+            case 's': nodes.attr[n] = NAME_S; break;
+            default:
+                printf("What attribute is this? %c\n", p[0]);
+                exit(1);
+            }
+            nodes.op[n] = p[1];
+            nodes.value[n] = atoi(p + 2);
+            /* The target gets resolved below */
+            nodes.yes[n] = colon + 1 - workflows[w].rules;
+            p = sep + 1;
         }
-        int attr[4];
-        sscanf(buf, "{x=%d,m=%d,a=%d,s=%d}", &attr[0], &attr[1], &attr[2], &attr[3]);
+        workflows[w].fallback = p;
+    }
+
+    /* And link them all up */
+    for (int w = 0; w < count; w++) {
+        struct workflow *flow = &workflows[w];
 
-        if (process_workflows(flow_start, attr)) {
-            int sum = attr[0] + attr[1] + attr[2] + attr[3];
+        for (int r = 0; r < flow->count; r++) {
+            int n = flow->first + r;
+
+            nodes.yes[n] = find_target(flow->rules + nodes.yes[n], 0);
+            if (r + 1 < flow->count) {
+                nodes.no[n] = n + 1;
+            } else {
+                nodes.no[n] = find_target(flow->fallback, 0);
+            }
             if (opts.debug) {
-                printf("  Accepted item: %d\n", sum);
+                printf("  Node %d (%s): %d %c %d => %d, else %d\n",
+                       n, flow->name, nodes.attr[n], nodes.op[n], nodes.value[n],
+                       nodes.yes[n], nodes.no[n]);
             }
-            total += sum;
         }
     }
-    if (opts.debug) {
-        printf("DEBUG: End of file\n");
-    }
-    printf("Total accepted: %d\n", total);
+    return lineno + 1;
 }
 
-
-/*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
- */
 void
-parse_options(int *argc, char **argv[])
+free_workflows()
 {
-    int ch;
-    char *argv0;
+    free(nodes.attr);
+    free(nodes.op);
+    free(nodes.value);
+    free(nodes.yes);
+    free(nodes.no);
+    free(names);
+    free(workflows);
+    workflows = NULL;
+    names = NULL;
+}
 
-    argv0 = (*argv)[0];
+/*
+ * The parts go through the tree in batches, a step at a time for all
+ * of them, so the lookups for one part don't have to wait for those of
+ * the previous one.
+ */
+# define BATCH 64
 
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
+long
+process_batch(int start, int attr[][4], int total)
+{
+    int node[BATCH];
+    int active = total;
+    long accepted = 0;
 
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
+    for (int i = 0; i < total; i++) {
+        node[i] = start;
     }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
+    while (active > 0) {
+        active = 0;
+        for (int i = 0; i < total; i++) {
+            int n = node[i];
+
+            if (n < 0) {
+                continue;
+            }
+            int a = attr[i][nodes.attr[n]];
+            bool pass = nodes.op[n] == '<' ? a < nodes.value[n] : a > nodes.value[n];
+            node[i] = pass ? nodes.yes[n] : nodes.no[n];
+            active += node[i] >= 0;
         }
     }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
+    for (int i = 0; i < total; i++) {
+        if (node[i] == WORKFLOW_A) {
+            int sum = attr[i][0] + attr[i][1] + attr[i][2] + attr[i][3];
+            if (opts.debug) {
+                printf("  Accepted item: %d\n", sum);
+            }
+            accepted += sum;
+        }
     }
-#endif
+    return accepted;
 }
 
-
 /*
- * Print a minimal usage blurb for the program.
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
+solve(struct aoc_input *in)
 {
-    char *name;
+    size_t lineno;
+    long total = 0;
+    int attr[BATCH][4];
+    int batch = 0;
 
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
+    lineno = compile_workflows(in);
+    int start = find_target("in", 0);
+    if (opts.debug) {
+        printf("Node to start at: %d\n", start);
+        printf("\n");
     }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
+    /* Parse the parts */
+    for (; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
+
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        if (sscanf(buf, "{x=%d,m=%d,a=%d,s=%d}",
+                   &attr[batch][0], &attr[batch][1], &attr[batch][2], &attr[batch][3]) != 4) {
+            continue;
+        }
+        batch++;
+        if (batch == BATCH) {
+            total += process_batch(start, attr, batch);
+            batch = 0;
+        }
+    }
+    total += process_batch(start, attr, batch);
+    if (opts.debug) {
+        printf("DEBUG: End of file\n");
     }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    printf("Total accepted: %ld\n", total);
+    free_workflows();
 }
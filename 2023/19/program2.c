@@ -5,112 +5,274 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2023
-# define DAY    19
-# define PART    2
+AOC_PROGRAM(2023, 19, 2);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
 
-# define MAX_LEN 1024
+typedef enum names {
+    NAME_X,
+    NAME_M,
+    NAME_A,
+    NAME_S
+} name;
+
+/*
+ * The workflows get compiled into a decision tree: every rule is a
+ * node, which sends a part on to the node in yes[] when the test
+ * passes, and to the one in no[] (the next rule, or the fallback) if
+ * not. Nodes point at other nodes directly, or at one of these:
+ */
+# define WORKFLOW_A -1
+# define WORKFLOW_R -2
 
 struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
+    int   total;
+    name *attr;
+    char *op;
+    int  *value;
+    int  *yes;
+    int  *no;
+} nodes;
 
+/*
+ * The workflows as found in the input, with their names interned in an
+ * open addressing table (of twice the size, at least).
+ */
+struct workflow {
+    char *name;
+    char *rules;
+    int   count;
+    int   first;
+    char *fallback;
+    int   entry;
+};
+
+struct workflow *workflows = NULL;
+int count = 0;
 
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+int *names = NULL;
+int names_size;
 
+unsigned int
+hash_name(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    for (; *name; name++) {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+    return hash;
+}
 
 /*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
+ * Returns the name's slot in the table: either the one with the name,
+ * or the empty one it would go into.
  */
 int
-main(int argc, char *argv[], char *env[])
+name_slot(const char *name)
 {
-    parse_options(&argc, &argv);
+    int slot = hash_name(name) & (names_size - 1);
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
+    while (names[slot] != -1 && strcmp(workflows[names[slot]].name, name)) {
+        slot = (slot + 1) & (names_size - 1);
     }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
+    return slot;
+}
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+/*
+ * Where a part goes when it's sent to the named workflow
+ */
+int
+find_target(const char *name, int depth)
+{
+    if (!strcmp(name, "A")) {
+        return WORKFLOW_A;
+    }
+    if (!strcmp(name, "R")) {
+        return WORKFLOW_R;
+    }
+    int w = names[name_slot(name)];
+    if (w == -1) {
+        printf("Could not find the workflow for %s?\n", name);
+        exit(1);
+    }
+    if (workflows[w].count > 0) {
+        return workflows[w].first;
+    }
+    /* Without any rules, it's the same as where it falls back to */
+    if (depth > count) {
+        printf("Oops. The workflows loop around at %s.\n", name);
+        exit(1);
+    }
+    return find_target(workflows[w].fallback, depth + 1);
+}
+
+/*
+ * Go through the lines with workflows, and compile them. Returns the
+ * number of lines used (including the empty one after them).
+ */
+size_t
+compile_workflows(struct aoc_input *in)
+{
+    size_t lineno;
+
+    workflows = malloc((in->count + 1) * sizeof(struct workflow));
+    if (workflows == NULL) {
+        printf("Oops. Failed to allocate the workflows.\n");
+        exit(1);
+    }
+    count = 0;
+    nodes.total = 0;
+    for (lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
 
         if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
+            printf("DEBUG: Line received: '%s'\n", buf);
         }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
+        if (!in->lines[lineno].len) {
+            break;
         }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
+        /* name{rule,rule,...,fallback} */
+        char *rules = strchr(buf, '{');
+        char *end = strchr(buf, '}');
+        if (rules == NULL || end == NULL) {
+            printf("Oops. Can't make sense of workflow '%s'.\n", buf);
+            exit(1);
         }
-        process_file(fd);
-        fclose(fd);
+        *rules++ = '\0';
+        *end = '\0';
+
+        struct workflow *flow = &workflows[count];
+        flow->name = buf;
+        flow->rules = rules;
+        flow->count = 0;
+        for (char *p = rules; *p; p++) {
+            if (*p == ',') {
+                flow->count++;
+            }
+        }
+        flow->first = nodes.total;
+        nodes.total += flow->count;
+        count++;
+    }
+    if (opts.debug) {
+        printf("Found a total of %d workflows, with %d rules\n", count, nodes.total);
     }
-}
 
-typedef enum names {
-    NAME_X,
-    NAME_M,
-    NAME_A,
-    NAME_S
-} name;
+    for (names_size = 1024; names_size < count * 2; names_size *= 2) {
+        /* Just finding the size */
+    }
+    names = malloc(names_size * sizeof(int));
+    nodes.attr = malloc((nodes.total + 1) * sizeof(name));
+    nodes.op = malloc(nodes.total + 1);
+    nodes.value = malloc((nodes.total + 1) * sizeof(int));
+    nodes.yes = malloc((nodes.total + 1) * sizeof(int));
+    nodes.no = malloc((nodes.total + 1) * sizeof(int));
+    if (names == NULL || nodes.attr == NULL || nodes.op == NULL || nodes.value == NULL ||
+        nodes.yes == NULL || nodes.no == NULL) {
+        printf("Oops. Failed to allocate the decision tree.\n");
+        exit(1);
+    }
+    for (int i = 0; i < names_size; i++) {
+        names[i] = -1;
+    }
+    for (int w = 0; w < count; w++) {
+        int slot = name_slot(workflows[w].name);
 
-typedef struct rule {
-    name attr;
-    char op;
-    int  value;
-    char target[5];
-} rule;
+        if (names[slot] != -1) {
+            printf("Oops. Workflow %s is there twice.\n", workflows[w].name);
+            exit(1);
+        }
+        names[slot] = w;
+    }
 
-typedef struct workflow {
-    char name[5];
-    rule rules[5];
-    int  count;
-    char fallback[5];
-} workflow;
+    /* Split up the rules, terminating the target names in place */
+    for (int w = 0; w < count; w++) {
+        char *p = workflows[w].rules;
 
-workflow workflows[600];
+        for (int r = 0; r < workflows[w].count; r++) {
+            char *sep = strchr(p, ',');
+            char *colon = strchr(p, ':');
+            int n = workflows[w].first + r;
 
-int count = 0;
+            if (colon == NULL || colon > sep || (p[1] != '<' && p[1] != '>')) {
+                printf("Oops. Can't make sense of rule '%.*s'.\n", (int)(sep - p), p);
+                exit(1);
+            }
+            *sep = '\0';
+            switch (p[0]) {
+            case 'x': nodes.attr[n] = NAME_X; break;
+            case 'm': nodes.attr[n] = NAME_M; break;
+            case 'a': nodes.attr[n] = NAME_A; break;
+            case 's': nodes.attr[n] = NAME_S; break;
+            default:
+                printf("What attribute is this? %c\n", p[0]);
+                exit(1);
+            }
+            nodes.op[n] = p[1];
+            nodes.value[n] = atoi(p + 2);
+            /* The target gets resolved below */
+            nodes.yes[n] = colon + 1 - workflows[w].rules;
+            p = sep + 1;
+        }
+        workflows[w].fallback = p;
+    }
+
+    /* And link them all up */
+    for (int w = 0; w < count; w++) {
+        struct workflow *flow = &workflows[w];
+
+        for (int r = 0; r < flow->count; r++) {
+            int n = flow->first + r;
 
+            nodes.yes[n] = find_target(flow->rules + nodes.yes[n], 0);
+            if (r + 1 < flow->count) {
+                nodes.no[n] = n + 1;
+            } else {
+                nodes.no[n] = find_target(flow->fallback, 0);
+            }
+            if (opts.debug) {
+                printf("  Node %d (%s): %d %c %d => %d, else %d\n",
+                       n, flow->name, nodes.attr[n], nodes.op[n], nodes.value[n],
+                       nodes.yes[n], nodes.no[n]);
+            }
+        }
+    }
+    return lineno + 1;
+}
+
+void
+free_workflows()
+{
+    free(nodes.attr);
+    free(nodes.op);
+    free(nodes.value);
+    free(nodes.yes);
+    free(nodes.no);
+    free(names);
+    free(workflows);
+    workflows = NULL;
+    names = NULL;
+}
+
+/*
+ * For part 2 the whole range of possible parts goes through the tree,
+ * splitting it up wherever a rule cuts through a range.
+ */
 typedef struct segment {
-    int    flow;
+    int    node;
     int    ranges[4][2];
 } segment;
 
-segment segments[400];
+segment *segments = NULL;
 int segments_total = 0;
+int segments_size = 0;
 
 
 void
@@ -122,15 +284,20 @@ dump_ranges(int ranges[4][2])
 }
 
 void
-add_segment(int flow, int ranges[4][2])
+add_segment(int node, int ranges[4][2])
 {
-    segments[segments_total].flow = flow;
-    for (int i = 0; i < 4; i++) {
-        segments[segments_total].ranges[i][0] = ranges[i][0];
-        segments[segments_total].ranges[i][1] = ranges[i][1];
+    if (segments_total == segments_size) {
+        segments_size = segments_size ? segments_size * 2 : 256;
+        segments = realloc(segments, segments_size * sizeof(segment));
+        if (segments == NULL) {
+            printf("Oops. Failed to grow the segments to %d.\n", segments_size);
+            exit(1);
+        }
     }
+    segments[segments_total].node = node;
+    memcpy(segments[segments_total].ranges, ranges, sizeof(segments[segments_total].ranges));
     if (opts.debug) {
-        printf("Adding segment #%d at workflow %d:\n", segments_total + 1, flow);
+        printf("Adding segment #%d at node %d:\n", segments_total + 1, node);
         dump_ranges(segments[segments_total].ranges);
     }
     segments_total++;
@@ -139,27 +306,6 @@ add_segment(int flow, int ranges[4][2])
 
 long combinations = 0;
 
-# define WORKFLOW_A -1
-# define WORKFLOW_R -2
-# define WORKFLOW_E -3
-
-int
-find_workflow(char name[5])
-{
-    if (!strcmp(name, "A")) {
-        return WORKFLOW_A;
-    }
-    if (!strcmp(name, "R")) {
-        return WORKFLOW_R;
-    }
-    for (int w = 0; w < count; w++) {
-        if (!strcmp(workflows[w].name, name)) {
-            return w;
-        }
-    }
-    return WORKFLOW_E;
-}
-
 void
 add_combinations(int ranges[4][2])
 {
@@ -174,6 +320,32 @@ add_combinations(int ranges[4][2])
     combinations += comb;
 }
 
+/*
+ * Send the ranges on to a node, or settle them if they're done
+ */
+void
+send_segment(int node, int ranges[4][2])
+{
+    switch (node) {
+    case WORKFLOW_A:
+        if (opts.debug) {
+            printf("Segment ACCEPTED:\n");
+            dump_ranges(ranges);
+        }
+        add_combinations(ranges);
+        break;
+    case WORKFLOW_R:
+        if (opts.debug) {
+            printf("Segment REJECTED:\n");
+            dump_ranges(ranges);
+        }
+        break;
+    default:
+        add_segment(node, ranges);
+        break;
+    }
+}
+
 void
 process_segments()
 {
@@ -184,353 +356,75 @@ process_segments()
         memcpy(&cur, &segments[segments_total - 1], sizeof(segment));
         segments_total--;
 
-        if (opts.debug) {
-            printf("Segment at workflow %d\n", cur.flow);
-            dump_ranges(cur.ranges);
-        }
-
-        int flow = cur.flow;
-        char *next = NULL;
-
-        bool done = false;
-        if (opts.debug) {
-            printf("Checking against workflow %d\n", flow);
-        }
-        for (int r = 0; r < workflows[flow].count; r++) {
-            int attr = workflows[flow].rules[r].attr;
-            bool split = false;
-            int ranges_copy[4][2];
-
-            for (int i = 0; i < 4; i++) {
-                ranges_copy[i][0] = cur.ranges[i][0];
-                ranges_copy[i][1] = cur.ranges[i][1];
+        /* Follow the ranges down the tree, splitting off what passes */
+        int n = cur.node;
+        while (n >= 0) {
+            int attr = nodes.attr[n];
+            int value = nodes.value[n];
+            int *range = cur.ranges[attr];
+            int pass[2], fail[2];
+
+            if (nodes.op[n] == '<') {
+                pass[0] = range[0];
+                pass[1] = value - 1 < range[1] ? value - 1 : range[1];
+                fail[0] = value > range[0] ? value : range[0];
+                fail[1] = range[1];
+            } else {
+                pass[0] = value + 1 > range[0] ? value + 1 : range[0];
+                pass[1] = range[1];
+                fail[0] = range[0];
+                fail[1] = value < range[1] ? value : range[1];
             }
-
             if (opts.debug) {
-                printf("  Checking against rule %d: %d %c %d (attr range = %d - %d)\n",
-                       r,
-                       attr,
-                       workflows[flow].rules[r].op,
-                       workflows[flow].rules[r].value,
-                       cur.ranges[attr][0], cur.ranges[attr][1]);
+                printf("  Node %d: %d %c %d (attr range = %d - %d)\n",
+                       n, attr, nodes.op[n], value, range[0], range[1]);
             }
+            if (pass[0] <= pass[1]) {
+                int ranges_copy[4][2];
 
-            switch (workflows[flow].rules[r].op) {
-            case '<':
-                if (cur.ranges[attr][1] < workflows[flow].rules[r].value) {
-                    /*
-                     * Completely to the left
-                     *                              < [value]
-                     * [0]==== ranges[attr] ====[1]
-                     */
-                    next = workflows[flow].rules[r].target;
-                    done = true;
-                } else if (cur.ranges[attr][0] < workflows[flow].rules[r].value) {
-                    /*
-                     * Partially to the left
-                     *
-                     *  <cur>    < [value]   <copy>
-                     * [0]==== ranges[attr] ====[1]
-                     */
-                    split = true;
-                    next = workflows[flow].rules[r].target;
-
-                    /* cur.ranges keeps searching for a match */
-                    cur.ranges[attr][0] = workflows[flow].rules[r].value;
-
-                    /* copy is going to be processed below */
-                    ranges_copy[attr][1] = workflows[flow].rules[r].value - 1;
-                }
-                break;
-            case '>':
-                if (cur.ranges[attr][0] > workflows[flow].rules[r].value) {
-                    /*
-                     * Completely to the right
-                     *
-                     * [value] >
-                     *           [0]==== ranges[attr] ====[1]
-                     */
-                    next = workflows[flow].rules[r].target;
-                    done = true;
-                } else if (cur.ranges[attr][1] > workflows[flow].rules[r].value) {
-                    /*
-                     * Partially to the right
-                     *
-                     * <copy>   [value] >     <cur>
-                     * [0]==== ranges[attr] ====[1]
-                     */
-                    split = true;
-                    next = workflows[flow].rules[r].target;
-
-                    /* cur.ranges keeps searching for a match */
-                    cur.ranges[attr][1] = workflows[flow].rules[r].value;
-
-                    /* copy is going to be processed below */
-                    ranges_copy[attr][0] = workflows[flow].rules[r].value + 1;
-                }
-                break;
-            default:
-                printf("What operator is this? %c\n", workflows[flow].rules[r].op);
-                exit(1);
+                memcpy(ranges_copy, cur.ranges, sizeof(ranges_copy));
+                ranges_copy[attr][0] = pass[0];
+                ranges_copy[attr][1] = pass[1];
+                send_segment(nodes.yes[n], ranges_copy);
             }
-            if (NULL != next) {
-                int newflow = find_workflow(next);
-                switch (newflow) {
-                case WORKFLOW_A:
-                    if (opts.debug) {
-                        printf("Done with this segment:\n");
-                        dump_ranges(ranges_copy);
-                    }
-                    add_combinations(ranges_copy);
-                    break;
-                case WORKFLOW_R:
-                    break;
-                case WORKFLOW_E:
-                    printf("Could not find the workflow for %s?\n", next);
-                    exit(1);
-                default:
-                    add_segment(newflow, ranges_copy);
-                    break;
-                }
-                if (!split) {
-                    break; /* for */
-                }
+            if (fail[0] > fail[1]) {
+                /* Nothing left */
+                break;
             }
-        }
-
-        if (done) {
-            continue;
-        }
-
-        next = workflows[flow].fallback;
-        int newflow = find_workflow(next);
-        switch (newflow) {
-        case WORKFLOW_A:
-            if (opts.debug) {
-                printf("Segment ACCEPTED:\n");
-                dump_ranges(cur.ranges);
+            range[0] = fail[0];
+            range[1] = fail[1];
+            n = nodes.no[n];
+            if (n < 0) {
+                send_segment(n, cur.ranges);
             }
-            add_combinations(cur.ranges);
-            break;
-        case WORKFLOW_R:
-            if (opts.debug) {
-                printf("Segment REJECTED:\n");
-                dump_ranges(cur.ranges);
-            }
-            break;
-        case WORKFLOW_E:
-            printf("Could not find the workflow for %s?\n", next);
-            exit(1);
-        default:
-            add_segment(newflow, cur.ranges);
-            break;
         }
     }
 }
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-process_file(FILE *fd)
+solve(struct aoc_input *in)
 {
-    char buf[MAX_LEN + 1];
-    int total = 0;
+    int ranges[4][2];
 
-    count = 0;
     combinations = 0;
-
-    /* Parse workflows */
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
-
-            SHA256((unsigned char *)buf, strlen(buf), digest);
-
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
-
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
-        }
-        if (!strlen(buf)) {
-            break;
-        }
-        if (opts.debug) {
-            printf("A: %s\n", buf);
-        }
-        char name[5];
-        char info[MAX_LEN + 1];
-        sscanf(buf, "%[a-z]{%[^}]}", name, info);
-
-        strcpy(workflows[count].name, name);
-        workflows[count].count = 0;
-
-        int total = 0;
-        char *p = info;
-        while (true) {
-            char *sep = strchr(p, ',');
-            if (NULL == sep) {
-                if (opts.debug) {
-                    printf("  Fallback: %s\n", p);
-                }
-                strcpy(workflows[count].fallback, p);
-                break;
-            }
-            sep[0] = '\0';
-            char attr, op;
-            int value;
-            char target[5];
-            sscanf(p, "%c%c%d:%s", &attr, &op, &value, target);
-            switch (attr) {
-            case 'x': workflows[count].rules[total].attr = NAME_X; break;
-            case 'm': workflows[count].rules[total].attr = NAME_M; break;
-            case 'a': workflows[count].rules[total].attr = NAME_A; break;
-            case 's': workflows[count].rules[total].attr = NAME_S; break;
-            }
-            workflows[count].rules[total].op = op;
-            workflows[count].rules[total].value = value;
-            strcpy(workflows[count].rules[total].target, target);
-            if (opts.debug) {
-                printf("  Rule: %c %c %d => %s\n", attr, op, value, target);
-            }
-            total++;
-            p = sep + 1;
-        }
-        workflows[count].count = total;
-        if (opts.debug) {
-            printf("Total of %d rules\n", total);
-        }
-        count++;
-    }
+    segments_total = 0;
+    compile_workflows(in);
     if (opts.debug) {
         printf("DEBUG: End of file\n");
     }
-
-    if (opts.debug) {
-        printf("Found a total of %d workflows\n", count);
-    }
-
-    int flow_start = 0;
-    for (int w = 0; w < count; w++) {
-        if (!strcmp(workflows[w].name, "in")) {
-            flow_start = w;
-            break;
-        }
-    }
-    if (opts.debug) {
-        printf("Workflow to start at: %d\n", flow_start);
-        printf("\n");
-    }
-    segments[segments_total].flow = flow_start;
     for (int i = 0; i < 4; i++) {
-        segments[segments_total].ranges[i][0] = 1;
-        segments[segments_total].ranges[i][1] = 4000;
+        ranges[i][0] = 1;
+        ranges[i][1] = 4000;
     }
-    segments_total++;
-
+    send_segment(find_target("in", 0), ranges);
     process_segments();
     printf("Total accepted: %ld\n", combinations);
-}
-
-
-/*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
- */
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
-    }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
-    }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
-    }
-#endif
-}
-
-
-/*
- * Print a minimal usage blurb for the program.
- */
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    free_workflows();
+    free(segments);
+    segments = NULL;
+    segments_size = 0;
 }
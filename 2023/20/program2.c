@@ -5,79 +5,19 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
+# include <stdint.h>     /* uint64_t             */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2023
-# define DAY    20
-# define PART    2
+AOC_PROGRAM(2023, 20, 2);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
+/* The cycles are made with 12-bit counters; give up well after that */
+# define MAX_PUSHES 100000
 
-# define MAX_LEN 1024
-
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
-
-
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
-
-
-/*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
- */
-int
-main(int argc, char *argv[], char *env[])
-{
-    parse_options(&argc, &argv);
-
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
-    }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
-
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
-
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
-        }
-        process_file(fd);
-        fclose(fd);
-    }
-}
 
 # define LOW false
 # define HIGH true
@@ -85,25 +25,42 @@ main(int argc, char *argv[], char *env[])
 typedef enum type {
     START,
     FLIP,
-    CONJ
+    CONJ,
+    /* Only ever mentioned as a target, like "output" */
+    SINK
 } type;
 
+/*
+ * The network, compiled: modules and the connections between them are
+ * referred to by their index. Every connection has its own slot in the
+ * memory of a conjunction module it leads to, which is a bitmask.
+ */
 typedef struct module {
-    type t;
-    char name[20];
-    char targets[20][20];
-    int t_total;
-    struct inputs {
-        bool state;
-        int mod;
-    } inputs[20];
-    int i_total;
-    bool state;
+    type      t;
+    char     *name;
+    char     *target_names;
+    int       targets;      /* First connection in edges[] */
+    int       t_total;
+    int       i_total;
+    uint64_t *memory;       /* Which inputs last sent a high pulse */
+    int       high_inputs;
+    bool      state;
+    long      high_sent;
+    long      low_sent;
 } module;
 
-module modules[100];
+module *modules = NULL;
 int count = 0;
 
+struct edge {
+    int from;
+    int to;
+    int slot;
+} *edges = NULL;
+int e_total = 0;
+
+int broadcaster = -1;
+
 /*
  * Key sentence:
  *
@@ -123,420 +80,415 @@ dump_module(int i)
         break;
     case CONJ:
         printf("Conjunctor module (%s):\n", modules[i].name);
-        printf("  Current state: %s\n", modules[i].state ? "-high" : "-low");
+        printf("  High inputs: %d/%d\n", modules[i].high_inputs, modules[i].i_total);
         break;
+    case SINK:
+        printf("Output module (%s)\n\n", modules[i].name);
+        return;
     }
     printf("  Targets (%d):\n    ", modules[i].t_total);
     for (int j = 0; j < modules[i].t_total; j++) {
-        printf("%s ", modules[i].targets[j]);
+        printf("%s ", modules[edges[modules[i].targets + j].to].name);
     }
-    printf("\n");
-    if (modules[i].i_total > 0) {
-        printf("  Inputs (%d):\n", modules[i].i_total);
-        for (int j = 0; j < modules[i].i_total; j++) {
-            printf("    %d (%s) -> %s\n",
-                   modules[i].inputs[j].mod,
-                   modules[modules[i].inputs[j].mod].name,
-                   modules[i].inputs[j].state ? "-high" : "-low");
-        }
-    }
-    printf("\n");
+    printf("\n\n");
 }
 
-int high_count = 0, low_count = 0;
-int broadcaster = 0;
-
-struct queue {
-    char oname[20];
-    int origin;
-    int module;
-    bool value;
-} queue[100], queue_copy[100];
-
-int queue_size = 0;
-
-long pushes = 0;
-long steps = 0;
+/*
+ * Module names are interned in an open addressing table, which is only
+ * needed while compiling the network.
+ */
+int *names = NULL;
+int names_size;
 
 int
-find_module(char name[20])
+name_slot(const char *name)
 {
-    for (int i = 0; i < count; i++) {
-        if (!strcmp(modules[i].name, name)) {
-            return i;
-        }
+    unsigned int hash = 2166136261u;
+
+    for (const char *p = name; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    int slot = hash & (names_size - 1);
+    while (names[slot] != -1 && strcmp(modules[names[slot]].name, name)) {
+        slot = (slot + 1) & (names_size - 1);
     }
-    /* Not found, like "output"? */
-    return -1;
+    return slot;
 }
 
-/* For tracking the inputs of 'dd' that sent it a high pulse. */
-int dd_high_pulses[100];
-int dd_inputs_seen;
-bool dd_tracking_done;
-
-void
-init_dd_tracking()
+int
+add_module(type t, char *name)
 {
-    dd_tracking_done = false;
-    dd_inputs_seen = 0;
-    for (int i = 0; i < 100; i++) {
-        dd_high_pulses[i] = 1;
-    }
+    modules[count].t = t;
+    modules[count].name = name;
+    modules[count].target_names = NULL;
+    modules[count].t_total = 0;
+    modules[count].i_total = 0;
+    modules[count].memory = NULL;
+    names[name_slot(name)] = count;
+    return count++;
 }
 
-bool
-track_dd_high_pulse(char name[20])
+/*
+ * Parse the modules, and link them all up by index
+ */
+void
+compile_network(struct aoc_input *in)
 {
-    if (opts.debug) {
-        printf("BUTTON PUSH %ld - STEP %ld - INPUT %s sends HIGH pulse to dd\n",
-               pushes, steps, name);
+    size_t max_modules = 0;
+
+    /* Every target can add a module, and there's one per line */
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        max_modules++;
+        for (char *p = in->lines[lineno].str; *p; p++) {
+            max_modules += (*p == ',' || *p == '>');
+        }
+    }
+    for (names_size = 256; names_size < max_modules * 2; names_size *= 2) {
+        /* Just finding the size */
     }
-    int m = find_module(name);
-    if (dd_high_pulses[m] > 1) {
-        printf("  Ignoring, already seen.\n");
-        return false;
+    modules = malloc(max_modules * sizeof(module));
+    edges = malloc(max_modules * sizeof(struct edge));
+    names = malloc(names_size * sizeof(int));
+    if (modules == NULL || edges == NULL || names == NULL) {
+        printf("Oops. Failed to allocate the network.\n");
+        exit(1);
     }
-    dd_high_pulses[m] = pushes;
-    dd_inputs_seen++;
+    for (int i = 0; i < names_size; i++) {
+        names[i] = -1;
+    }
+    count = 0;
+    e_total = 0;
+    broadcaster = -1;
 
-    int dd_m = find_module("dd");
-    if (opts.debug) {
-        printf("Seen high pulses for %d/%d inputs.\n",
-               dd_inputs_seen, modules[dd_m].i_total);
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
+        type t = START;
+
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        if (!in->lines[lineno].len) {
+            continue;
+        }
+        if (buf[0] == '&') {
+            t = CONJ;
+            buf++;
+        } else if (buf[0] == '%') {
+            t = FLIP;
+            buf++;
+        }
+        char *arrow = strstr(buf, " -> ");
+        if (arrow == NULL) {
+            printf("Oops. Can't make sense of module '%s'.\n", buf);
+            exit(1);
+        }
+        *arrow = '\0';
+        if (names[name_slot(buf)] != -1) {
+            printf("Oops. Module %s is there twice.\n", buf);
+            exit(1);
+        }
+        int m = add_module(t, buf);
+        modules[m].target_names = arrow + 4;
+        if (t == START) {
+            broadcaster = m;
+        }
     }
-    if (dd_inputs_seen < modules[dd_m].i_total) {
-        return false;
+    if (broadcaster == -1) {
+        printf("Oops. No broadcaster found.\n");
+        exit(1);
     }
-    dd_tracking_done = true; /* Huzzah! */
-    return true;
-}
 
-void
-queue_pulse(char name[20], int m, char m_name[20], bool v)
-{
-    int o = find_module(name);
+    int defined = count;
+    for (int m = 0; m < defined; m++) {
+        char *p = modules[m].target_names;
+
+        modules[m].targets = e_total;
+        while (p != NULL && *p) {
+            char *name = p;
 
-    /* Hardcoded a check for the module that sits right in front of "rx" */
-    if (!strcmp(m_name, "dd") && v == HIGH) {
-        if (track_dd_high_pulse(name)) {
-            /* We're done! */
-            return;
+            p = strchr(p, ',');
+            if (p != NULL) {
+                *p = '\0';
+                p += 2;
+            }
+            int target = names[name_slot(name)];
+            if (target == -1) {
+                target = add_module(SINK, name);
+            }
+            edges[e_total].from = m;
+            edges[e_total].to = target;
+            edges[e_total].slot = modules[target].i_total++;
+            e_total++;
+            modules[m].t_total++;
         }
     }
-    if (opts.debug) {
-        printf("%s (%d) %s-> %d (%s)\n",
-               name, o, v ? "-high" : "-low", m, m_name);
+    for (int m = 0; m < count; m++) {
+        if (modules[m].t == CONJ) {
+            modules[m].memory = calloc((modules[m].i_total + 63) / 64, sizeof(uint64_t));
+            if (modules[m].memory == NULL) {
+                printf("Oops. Failed to allocate the memory of %s.\n", modules[m].name);
+                exit(1);
+            }
+        }
     }
-    if (v) {
-        high_count++;
-    } else {
-        low_count++;
+    if (opts.debug) {
+        printf("DEBUG: End of file\n");
     }
-    strcpy(queue[queue_size].oname, name);
-    queue[queue_size].origin = o;
-    queue[queue_size].module = m;
-    queue[queue_size].value = v;
-    queue_size++;
 }
 
 void
-find_module_inputs()
+reset_network()
 {
     for (int m = 0; m < count; m++) {
-        for (int t = 0; t < modules[m].t_total; t++) {
-            int i = find_module(modules[m].targets[t]);
-            if (i == -1) {
-                continue;
-            }
-            if (modules[i].t == CONJ) {
-                if (opts.debug) {
-                    printf("Connecting target %s of %s to input of %s\n",
-                           modules[m].targets[t], modules[m].name, modules[i].name);
-                }
-                modules[i].inputs[modules[i].i_total].mod = m;
-                modules[i].inputs[modules[i].i_total].state = LOW;
-                modules[i].i_total++;
-            }
+        modules[m].state = LOW;
+        modules[m].high_inputs = 0;
+        modules[m].high_sent = 0;
+        modules[m].low_sent = 0;
+        if (modules[m].memory != NULL) {
+            memset(modules[m].memory, 0, (modules[m].i_total + 63) / 64 * sizeof(uint64_t));
         }
     }
 }
 
 void
-process_queue()
+free_network()
 {
-    if (opts.debug) {
-        printf("QUEUE size: %d\n", queue_size);
+    for (int m = 0; m < count; m++) {
+        free(modules[m].memory);
+    }
+    free(modules);
+    free(edges);
+    free(names);
+    modules = NULL;
+    edges = NULL;
+    names = NULL;
+}
+
+/*
+ * The pulses in flight, as a ring buffer of the connection they travel
+ * along (-1 for the button) and their value.
+ */
+struct pulse {
+    int  edge;
+    bool value;
+};
+
+struct {
+    struct pulse *pulses;
+    int           head;
+    int           total;
+    int           size;
+} queue;
+
+void
+queue_pulse(int edge, bool v)
+{
+    if (queue.total == queue.size) {
+        int size = queue.size ? queue.size * 2 : 1024;
+        struct pulse *pulses = malloc(size * sizeof(struct pulse));
+
+        if (pulses == NULL) {
+            printf("Oops. Failed to grow the queue to %d pulses.\n", size);
+            exit(1);
+        }
+        for (int i = 0; i < queue.total; i++) {
+            pulses[i] = queue.pulses[(queue.head + i) & (queue.size - 1)];
+        }
+        free(queue.pulses);
+        queue.pulses = pulses;
+        queue.head = 0;
+        queue.size = size;
     }
-    int copy_size = queue_size;
-    for (int i = 0; i < copy_size; i++) {
-        strcpy(queue_copy[i].oname, queue[i].oname);
-        queue_copy[i].origin = queue[i].origin;
-        queue_copy[i].module = queue[i].module;
-        queue_copy[i].value = queue[i].value;
+    struct pulse *p = &queue.pulses[(queue.head + queue.total) & (queue.size - 1)];
+    p->edge = edge;
+    p->value = v;
+    queue.total++;
+}
+
+/*
+ * Have module m send a pulse to all its targets
+ */
+static inline void
+send_pulses(int m, bool v)
+{
+    if (v) {
+        modules[m].high_sent += modules[m].t_total;
+    } else {
+        modules[m].low_sent += modules[m].t_total;
+    }
+    for (int e = modules[m].targets; e < modules[m].targets + modules[m].t_total; e++) {
+        queue_pulse(e, v);
     }
-    queue_size = 0;
-    for (int i = 0; i < copy_size; i++) {
-        int ori = queue_copy[i].origin;
-        int mod = queue_copy[i].module;
-        bool val = queue_copy[i].value;
+}
 
-        if (mod == -1) {
+/*
+ * When set, high pulses arriving at this module are reported to
+ * watch_high() (with the push they happened in).
+ */
+int watch = -1;
+long pushes = 0;
+
+void watch_high(struct edge *e);
+
+/*
+ * Push the button, and handle all the pulses that causes.
+ */
+void
+push_button()
+{
+    pushes++;
+    queue_pulse(-1, LOW);
+    while (queue.total > 0) {
+        struct pulse p = queue.pulses[queue.head];
+        int mod;
+
+        queue.head = (queue.head + 1) & (queue.size - 1);
+        queue.total--;
+        if (p.edge == -1) {
+            mod = broadcaster;
+        } else {
+            mod = edges[p.edge].to;
             if (opts.debug) {
-                printf("Sent to a module without inputs or outputs.\n");
+                printf("%s %s-> %s\n", modules[edges[p.edge].from].name,
+                       p.value ? "-high" : "-low", modules[mod].name);
             }
-            continue;
         }
         switch (modules[mod].t) {
         case START:
-            for (int m = 0; m < modules[mod].t_total; m++) {
-                int target = find_module(modules[mod].targets[m]);
-                queue_pulse(modules[mod].name, target, modules[mod].targets[m], val);
-            }
+            send_pulses(mod, p.value);
             break;
         case FLIP:
-            if (queue_copy[i].value == HIGH) {
-                if (opts.debug) {
-                    printf("Flip-flop module %s received a high pulse, nothing happens.\n",
-                           modules[mod].name);
-                }
+            if (p.value == HIGH) {
                 break;
             }
             modules[mod].state = !modules[mod].state;
-            if (opts.debug) {
-                printf("Flip-flop module %s received a low pulse and flipped to %d\n",
-                       modules[mod].name, modules[mod].state);
-            }
-            for (int m = 0; m < modules[mod].t_total; m++) {
-                int target = find_module(modules[mod].targets[m]);
-                queue_pulse(modules[mod].name, target, modules[mod].targets[m], modules[mod].state);
-            }
+            send_pulses(mod, modules[mod].state);
             break;
         case CONJ:
             {
-                bool all_high = true;
-                for (int m = 0; m < modules[mod].i_total; m++) {
-                    if (modules[mod].inputs[m].mod == ori) {
-                        if (opts.debug) {
-                            printf("Updating memory of input %d (%s) for %d (%s) to %d.\n",
-                                   ori, modules[ori].name, mod, modules[mod].name, val);
-                        }
-                        modules[mod].inputs[m].state = val;
-                    }
-                    if (!modules[mod].inputs[m].state) {
-                        all_high = false;
-                    }
-                }
-                if (opts.debug) {
-                    printf("All-high check for %s: %d\n", modules[mod].name, all_high);
+                struct edge *e = &edges[p.edge];
+                uint64_t *word = &modules[mod].memory[e->slot / 64];
+                uint64_t bit = 1ULL << (e->slot % 64);
+
+                if (mod == watch && p.value == HIGH) {
+                    watch_high(e);
                 }
-                all_high = !all_high;
-                for (int m = 0; m < modules[mod].t_total; m++) {
-                    int target = find_module(modules[mod].targets[m]);
-                    queue_pulse(modules[mod].name, target, modules[mod].targets[m], all_high);
+                if (p.value && !(*word & bit)) {
+                    *word |= bit;
+                    modules[mod].high_inputs++;
+                } else if (!p.value && (*word & bit)) {
+                    *word &= ~bit;
+                    modules[mod].high_inputs--;
                 }
+                send_pulses(mod, modules[mod].high_inputs != modules[mod].i_total);
             }
             break;
+        case SINK:
+            break;
         }
     }
 }
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * rx only gets a low pulse when all inputs of the conjunction module
+ * in front of it ('dd', in my input) last sent a high one. Those each
+ * do that on a cycle of their own, so note the first push each of them
+ * sends a high pulse in.
  */
+long *first_high = NULL;
+int inputs_seen;
+
 void
-process_file(FILE *fd)
+watch_high(struct edge *e)
 {
-    char buf[MAX_LEN + 1];
-
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
-
-            SHA256((unsigned char *)buf, strlen(buf), digest);
-
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
-
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
-        }
-        char *info = buf;
-
-        if (buf[0] == '&') {
-            modules[count].t = CONJ;
-            info = buf + 1;
-            modules[count].state = false;
-        } else if (buf[0] == '%') {
-            modules[count].t = FLIP;
-            modules[count].state = false;
-            info = buf + 1;
-        } else {
-            modules[count].t = START;
-            broadcaster = count;
-            info = buf;
-        }
-        int len;
-        sscanf(info, "%s -> %n", modules[count].name, &len);
-        info = info + len;
-
-        int total = 0;
-        while (true) {
-            sscanf(info, "%[a-z]%n", modules[count].targets[total], &len);
-            total++;
-            if (info[len] == ',') {
-                info = info + len + 2;
-            } else {
-                break;
-            }
-        }
-        modules[count].t_total = total;
-        modules[count].i_total = 0; /* post process for this */
-        count++;
+    if (first_high[e->slot] > 0) {
+        return;
     }
-    if (opts.debug) {
-        printf("DEBUG: End of file\n");
+    if (opts.debug || opts.verbose) {
+        printf("BUTTON PUSH %ld - INPUT %s sends HIGH pulse to %s\n",
+               pushes, modules[e->from].name, modules[e->to].name);
     }
-    find_module_inputs();
+    first_high[e->slot] = pushes;
+    inputs_seen++;
+}
+
+long
+gcd(long a, long b)
+{
+    while (b != 0) {
+        long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/*
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
+ */
+void
+solve(struct aoc_input *in)
+{
+    compile_network(in);
     if (opts.debug) {
         for (int m = 0; m < count; m++) {
             dump_module(m);
         }
         printf("Parsed %d modules.\n", count);
     }
-    pushes = 0;
-    init_dd_tracking();
-    while (true) {
-        queue_pulse("button", broadcaster, "broadcaster", LOW);
-        pushes++;
-        steps = 0;
-        while (queue_size > 0) {
-            steps++;
-            if (opts.debug) {
-                printf("  STEP %ld\n\n", steps);
-            }
-            process_queue();
-            if (dd_tracking_done) {
-                break;
-            }
-        }
-        if (opts.debug) {
-            printf("Finished after %ld steps.\n", steps);
-        }
-        if (dd_tracking_done) {
+    watch = -1;
+    for (int e = 0; e < e_total; e++) {
+        if (!strcmp(modules[edges[e].to].name, "rx")) {
+            watch = edges[e].from;
             break;
         }
     }
-    long multiplier = 1;
-    for (int i = 0; i < 100; i++) {
-        if (dd_high_pulses[i] > 1) {
-            printf("Input %d (%s) of module 'dd': %d\n",
-                   i, modules[i].name, dd_high_pulses[i]);
-            multiplier *= dd_high_pulses[i];
-        }
+    if (watch == -1 || modules[watch].t != CONJ) {
+        printf("Oops. This needs a conjunction module sending to rx.\n");
+        exit(1);
     }
-    printf("Multiplied values of the input modules of 'dd': %ld\n",
-           multiplier);
-}
-
-
-/*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
- */
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
+    first_high = calloc(modules[watch].i_total, sizeof(long));
+    if (first_high == NULL) {
+        printf("Oops. Failed to allocate the input tracking.\n");
+        exit(1);
     }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
+    inputs_seen = 0;
+    reset_network();
+    pushes = 0;
+    while (inputs_seen < modules[watch].i_total && pushes < MAX_PUSHES) {
+        push_button();
     }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
+    if (inputs_seen < modules[watch].i_total) {
+        printf("Oops. After %d pushes, these inputs of '%s' never sent a high pulse:",
+               MAX_PUSHES, modules[watch].name);
+        for (int e = 0; e < e_total; e++) {
+            if (edges[e].to == watch && first_high[edges[e].slot] == 0) {
+                printf(" %s", modules[edges[e].from].name);
+            }
+        }
+        printf("\n");
+        exit(1);
     }
-#endif
-}
 
+    long multiplier = 1;
+    for (int e = 0; e < e_total; e++) {
+        if (edges[e].to != watch) {
+            continue;
+        }
+        long cycle = first_high[edges[e].slot];
 
-/*
- * Print a minimal usage blurb for the program.
- */
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
+        printf("Input %d (%s) of module '%s': %ld\n",
+               edges[e].from, modules[edges[e].from].name, modules[watch].name, cycle);
+        multiplier = multiplier / gcd(multiplier, cycle) * cycle;
     }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    printf("Least common multiple of the cycles of the inputs of '%s': %ld\n",
+           modules[watch].name, multiplier);
+    free(first_high);
+    first_high = NULL;
+    free_network();
+    free(queue.pulses);
+    queue.pulses = NULL;
+    queue.size = 0;
+    queue.total = 0;
 }
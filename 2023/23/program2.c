@@ -5,100 +5,25 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
+# include <stdint.h>     /* uint64_t             */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2023
-# define DAY    23
-# define PART    2
+AOC_PROGRAM(2023, 23, 2);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
-
-# define MAX_LEN 1024
-
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
-
-
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
-
-
-/*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
- */
-int
-main(int argc, char *argv[], char *env[])
-{
-    parse_options(&argc, &argv);
-
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
-    }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
-
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
-
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
-        }
-        process_file(fd);
-        fclose(fd);
-    }
-}
 
 /*
  * paths  = .
  * forest = #
  * slopes = ^, >, v, <
  */
-char map[200][200];
+char **map = NULL;
 int max_row, max_col;
 
-bool visited[200][200];
-
-void
-visited_init()
-{
-    for (int row = 0; row < max_row; row++) {
-        for (int col = 0; col < max_col; col++) {
-            visited[row][col] = false;
-        }
-    }
-}
-
 /* Dealing with directions */
 typedef enum direction {
     UP = 0, RIGHT, DOWN, LEFT
@@ -117,186 +42,354 @@ next_position(int row, int col, direction dir, int *next_row, int *next_col) {
     }
 }
 
+bool
+is_path(int row, int col)
+{
+    return row >= 0 && col >= 0 && row < max_row && col < max_col && map[row][col] != '#';
+}
+
+/*
+ * The maze contracted into a graph: the junctions (the start, the end,
+ * and every spot with three or more ways to go) are the nodes, and the
+ * corridors between them the edges, weighted by their length. With at
+ * most 64 of them, a set of visited nodes fits in a uint64_t.
+ */
+# define MAX_NODES 64
+
+struct node {
+    int row, col;
+    int degree;
+    int next[4];
+    int steps[4];
+} nodes[MAX_NODES];
+int node_count;
+int start_node, end_node;
+
+/*
+ * The search aims for target_node, with target_steps added to get to
+ * the end from there; see build_graph() for why that isn't always the
+ * end node itself.
+ */
+int target_node, target_steps;
+
+int *node_at = NULL;
+
 int
-searching_rec(int row, int col, int steps)
+add_node(int row, int col)
 {
-    if (row == max_row - 1) {
-        /* Success */
-        if (opts.debug) {
-            printf("Reached the end point after %d steps.\n", steps);
-        }
-        return steps;
+    if (node_count == MAX_NODES) {
+        printf("Oops. More than %d junctions in the maze.\n", MAX_NODES);
+        exit(1);
     }
-    int max_steps = -1;
-    for (int d = 0; d < sizeof(direction); d++) {
-        int next_row, next_col;
+    nodes[node_count].row = row;
+    nodes[node_count].col = col;
+    nodes[node_count].degree = 0;
+    node_at[row * max_col + col] = node_count;
+    return node_count++;
+}
 
-        next_position(row, col, d, &next_row, &next_col);
-        if (next_row < 0) {
-            continue;
+/*
+ * Follow the corridor leaving node n in direction d, to the next
+ * junction (if it isn't a dead end), and add it as an edge.
+ */
+void
+follow_corridor(int n, direction d)
+{
+    int prev_row = nodes[n].row, prev_col = nodes[n].col;
+    int row, col;
+    int steps = 1;
+
+    next_position(prev_row, prev_col, d, &row, &col);
+    if (!is_path(row, col)) {
+        return;
+    }
+    while (node_at[row * max_col + col] == -1) {
+        bool moved = false;
+
+        for (int nd = 0; nd < 4; nd++) {
+            int next_row, next_col;
+
+            next_position(row, col, nd, &next_row, &next_col);
+            if ((next_row == prev_row && next_col == prev_col) || !is_path(next_row, next_col)) {
+                continue;
+            }
+            prev_row = row;
+            prev_col = col;
+            row = next_row;
+            col = next_col;
+            steps++;
+            moved = true;
+            break;
         }
-        if (map[next_row][next_col] == '#') {
-            continue;
+        if (!moved) {
+            /* Dead end */
+            return;
         }
-        if (visited[next_row][next_col]) {
-            continue;
+    }
+    struct node *node = &nodes[n];
+    node->next[node->degree] = node_at[row * max_col + col];
+    node->steps[node->degree] = steps;
+    node->degree++;
+}
+
+void
+build_graph()
+{
+    node_at = malloc(max_row * max_col * sizeof(int));
+    if (node_at == NULL) {
+        printf("Oops. Failed to allocate the junction map.\n");
+        exit(1);
+    }
+    for (int i = 0; i < max_row * max_col; i++) {
+        node_at[i] = -1;
+    }
+    node_count = 0;
+    start_node = end_node = -1;
+    for (int row = 0; row < max_row; row++) {
+        for (int col = 0; col < max_col; col++) {
+            if (!is_path(row, col)) {
+                continue;
+            }
+            if (row == 0) {
+                start_node = add_node(row, col);
+                continue;
+            }
+            if (row == max_row - 1) {
+                end_node = add_node(row, col);
+                continue;
+            }
+            int exits = 0;
+            for (int d = 0; d < 4; d++) {
+                int next_row, next_col;
+
+                next_position(row, col, d, &next_row, &next_col);
+                exits += is_path(next_row, next_col);
+            }
+            if (exits >= 3) {
+                add_node(row, col);
+            }
         }
-        visited[next_row][next_col] = true;
-        int tmp = searching_rec(next_row, next_col, steps + 1);
-        visited[next_row][next_col] = false;
-        if (tmp > max_steps) {
-            /* Works for -1 for either value as well */
-            max_steps = tmp;
+    }
+    if (start_node == -1 || end_node == -1) {
+        printf("Oops. Couldn't find the start and end of the maze.\n");
+        exit(1);
+    }
+    for (int n = 0; n < node_count; n++) {
+        for (int d = 0; d < 4; d++) {
+            follow_corridor(n, d);
         }
     }
-    if (max_steps == -1) {
-        return -1;
+    free(node_at);
+    node_at = NULL;
+
+    /*
+     * The end is only reachable through one junction, and once there,
+     * going anywhere else means never getting to the end. So aim for
+     * that junction instead, which prunes a lot of hopeless paths.
+     */
+    target_node = end_node;
+    target_steps = 0;
+    if (nodes[end_node].degree == 1 && nodes[end_node].next[0] != start_node) {
+        target_node = nodes[end_node].next[0];
+        target_steps = nodes[end_node].steps[0];
+    }
+    if (opts.verbose) {
+        printf("Contracted the maze into %d junctions:\n", node_count);
+        for (int n = 0; n < node_count; n++) {
+            printf("  %2d (%d,%d):", n, nodes[n].row, nodes[n].col);
+            for (int e = 0; e < nodes[n].degree; e++) {
+                printf(" %d (%d steps)", nodes[n].next[e], nodes[n].steps[e]);
+            }
+            printf("\n");
+        }
     }
-    return max_steps;
 }
 
+/*
+ * Longest path from node n to the target, not going through any of
+ * the visited nodes. Returns -1 if the target can't be reached.
+ */
 int
-searching()
+searching_rec(int n, uint64_t visited)
 {
-    visited_init();
+    if (n == target_node) {
+        return target_steps;
+    }
+    int max_steps = -1;
+    for (int e = 0; e < nodes[n].degree; e++) {
+        int next = nodes[n].next[e];
 
-    visited[0][1] = true;
-    return searching_rec(0, 1, 0);
+        if (visited & (1ULL << next)) {
+            continue;
+        }
+        int tmp = searching_rec(next, visited | (1ULL << next));
+        if (tmp >= 0 && tmp + nodes[n].steps[e] > max_steps) {
+            max_steps = tmp + nodes[n].steps[e];
+        }
+    }
+    return max_steps;
 }
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * The top of the search tree is expanded breadth first into tasks (a
+ * partial path each), which the threads then take to search the rest
+ * of the tree, each keeping track of the longest path it found.
  */
-void
-process_file(FILE *fd)
+# define TASKS_PER_THREAD 16
+
+struct task {
+    int      node;
+    uint64_t visited;
+    int      steps;
+};
+
+struct {
+    struct task *tasks;
+    int          count;
+    int          max_steps;
+} work;
+
+static void *
+search_init()
 {
-    char buf[MAX_LEN + 1];
+    int *max_steps = malloc(sizeof(int));
 
-    max_row = 0;
-    max_col = 0;
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
-        if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
+    if (max_steps == NULL) {
+        printf("Oops. Failed to allocate a search thread.\n");
+        exit(1);
+    }
+    *max_steps = -1;
+    return max_steps;
+}
 
-            SHA256((unsigned char *)buf, strlen(buf), digest);
+static bool
+search_tasks(void *scratch, long from, long to)
+{
+    int *max_steps = scratch;
 
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
+    for (long t = from; t < to; t++) {
+        struct task *task = &work.tasks[t];
+        int steps = searching_rec(task->node, task->visited);
 
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
+        if (steps >= 0 && task->steps + steps > *max_steps) {
+            *max_steps = task->steps + steps;
         }
-        if (!max_col) {
-            max_col = strlen(buf);
-        }
-        strcpy(map[max_row], buf);
-        max_row++;
-    }
-    if (opts.debug) {
-        printf("DEBUG: End of file\n");
     }
-    int max_steps = searching();
-    printf("Max steps to get there: %d\n", max_steps);
+    return true;
 }
 
-
-/*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
- */
-void
-parse_options(int *argc, char **argv[])
+static void
+search_reduce(void *scratch)
 {
-    int ch;
-    char *argv0;
+    int *max_steps = scratch;
 
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
+    if (*max_steps > work.max_steps) {
+        work.max_steps = *max_steps;
+    }
+}
 
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
+int
+searching()
+{
+    int threads = aoc_threads();
+    struct task *next_tasks;
+    int next_count;
+
+    /* Every partial path has at most 4 ways to continue */
+    work.tasks = malloc(sizeof(struct task));
+    next_tasks = NULL;
+    if (work.tasks == NULL) {
+        printf("Oops. Failed to allocate the search tasks.\n");
+        exit(1);
     }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
+    work.tasks[0].node = start_node;
+    work.tasks[0].visited = 1ULL << start_node;
+    work.tasks[0].steps = 0;
+    work.count = 1;
+    work.max_steps = -1;
+    while (work.count > 0 && work.count < threads * TASKS_PER_THREAD) {
+        next_tasks = malloc(work.count * 4 * sizeof(struct task));
+        if (next_tasks == NULL) {
+            printf("Oops. Failed to allocate the search tasks.\n");
+            exit(1);
         }
+        next_count = 0;
+        for (int t = 0; t < work.count; t++) {
+            struct task *task = &work.tasks[t];
+
+            if (task->node == target_node) {
+                if (task->steps + target_steps > work.max_steps) {
+                    work.max_steps = task->steps + target_steps;
+                }
+                continue;
+            }
+            for (int e = 0; e < nodes[task->node].degree; e++) {
+                int next = nodes[task->node].next[e];
+
+                if (task->visited & (1ULL << next)) {
+                    continue;
+                }
+                next_tasks[next_count].node = next;
+                next_tasks[next_count].visited = task->visited | (1ULL << next);
+                next_tasks[next_count].steps = task->steps + nodes[task->node].steps[e];
+                next_count++;
+            }
+        }
+        free(work.tasks);
+        work.tasks = next_tasks;
+        work.count = next_count;
     }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
+    if (opts.verbose) {
+        printf("Searching %d partial paths with %d threads.\n", work.count, threads);
     }
-#endif
+    aoc_parallel_for(work.count, 1, search_init, search_tasks, search_reduce, free);
+    free(work.tasks);
+    work.tasks = NULL;
+    return work.max_steps;
 }
 
-
 /*
- * Print a minimal usage blurb for the program.
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
+solve(struct aoc_input *in)
 {
-    char *name;
+    max_row = 0;
+    max_col = 0;
+    map = calloc(in->count + 1, sizeof(char *));
+    if (map == NULL) {
+        printf("Oops. Failed to allocate the map.\n");
+        exit(1);
+    }
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
 
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        if (in->lines[lineno].len == 0) {
+            break;
+        }
+        if (!max_col) {
+            max_col = in->lines[lineno].len;
+        } else if (in->lines[lineno].len != max_col) {
+            printf("Oops. Line %zu is not %d long.\n", lineno + 1, max_col);
+            exit(1);
+        }
+        map[max_row] = buf;
+        max_row++;
     }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
+    if (opts.debug) {
+        printf("DEBUG: End of file\n");
+    }
+    if (max_row < 2) {
+        printf("Oops. No maze found.\n");
+        exit(1);
     }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    build_graph();
+    int max_steps = searching();
+    printf("Max steps to get there: %d\n", max_steps);
+    free(map);
+    map = NULL;
 }
@@ -5,541 +5,384 @@
  * =======================================================================
  */
 
-# include <libgen.h>     /* basename()           */
 # include <stdbool.h>    /* bool, true, false    */
 # include <stdio.h>      /* FILE, *printf(), etc */
 # include <stdlib.h>     /* exit()               */
 # include <string.h>     /* strlen()             */
-# include <unistd.h>     /* getopt()             */
-# include <sys/stat.h>   /* stat()               */
-# include <sys/errno.h>  /* errno                */
 
-# include <openssl/sha.h>
+# include "aoc.h"
 
-# define YEAR 2023
-# define DAY    25
-# define PART    1
+AOC_PROGRAM(2023, 25, 1);
 
-# define STR(x) _STR(x)
-# define _STR(x) #x
-
-# define MAX_LEN 1024
-
-struct {
-    bool debug   : 1;
-    bool dryrun  : 1;
-    bool verbose : 1;
-} opts;
-
-
-void process_file(FILE *);
-void parse_options(int *argc, char **argv[]);
-void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
 
+/* The number of wires to cut */
+# define CUT_WIRES 3
 
 /*
- * Main code block which checks the options and either read files (if
- * provided after the options), or whatever is fed to it on stdin,
- * calling process_file() for it.
+ * The names of the parts (pointing into the input), interned in an
+ * open addressing table that's kept at most half full.
  */
-int
-main(int argc, char *argv[], char *env[])
-{
-    parse_options(&argc, &argv);
+char **names = NULL;
+int t_parts, s_parts;
 
-    if (argc == 0) {
-        if (opts.debug) {
-            printf("Processing data from stdin.\n");
-        }
-        process_file(stdin);
-        return 0;
-    }
-    for (int i = 0; i < argc; i++) {
-        struct stat st;
-        FILE *fd;
+int *table = NULL;
+int table_size;
 
-        if (stat(argv[i], &st)) {
-            printf("File not found: '%s'\n", argv[i]);
-            return 1;
-        }
+static unsigned int
+hash_name(const char *name)
+{
+    unsigned int hash = 2166136261u;
 
-        if (opts.debug) {
-            printf("Opening %s for reading.\n", argv[i]);
-        }
-        fd = fopen(argv[i], "r");
-        if (fd == NULL) {
-            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
-            return 1;
-        }
-        if (opts.debug) {
-            printf("Processing data from '%s'.\n", argv[i]);
-        }
-        process_file(fd);
-        fclose(fd);
+    for (const char *p = name; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
     }
+    return hash;
 }
 
-
-# define MAX_PARTS  1500
-# define MAX_TARGETS  20
-# define MAX_NAME     10
-
-struct part {
-    char name[MAX_NAME];
-    int  targets[MAX_TARGETS];
-    int  t_targets;
-    bool seen;
-    int  depth;
-} parts[MAX_PARTS];
-int t_parts;
-
-int cuts[10];
-int t_cuts;
-
-void
-init_parts()
+static void
+table_grow()
 {
-    t_parts = 0;
+    free(table);
+    table_size = table_size ? table_size * 2 : 4096;
+    table = malloc(table_size * sizeof(int));
+    if (table == NULL) {
+        printf("Oops. Failed to allocate the name table.\n");
+        exit(1);
+    }
+    for (int i = 0; i < table_size; i++) {
+        table[i] = -1;
+    }
+    for (int p = 0; p < t_parts; p++) {
+        unsigned int slot = hash_name(names[p]) & (table_size - 1);
+
+        while (table[slot] != -1) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        table[slot] = p;
+    }
 }
 
 /*
- * Find or add the part entry, return the ID for it.
+ * Find or add the part, return the ID for it.
  */
-int
-add_part(char name[MAX_NAME])
+static int
+add_part(char *name)
 {
-    for (int i = 0; i < t_parts; i++) {
-        if (!strcmp(parts[i].name, name)) {
+    unsigned int slot = hash_name(name) & (table_size - 1);
+
+    while (table[slot] != -1) {
+        if (!strcmp(names[table[slot]], name)) {
             /* Already existed. */
-            return i;
+            return table[slot];
         }
+        slot = (slot + 1) & (table_size - 1);
     }
-    if (t_parts == MAX_PARTS) {
-        printf("Too many parts, cannot add %s.\n", name);
-        exit(1);
+    if (t_parts == s_parts) {
+        s_parts = s_parts ? s_parts * 2 : 2048;
+        names = realloc(names, s_parts * sizeof(char *));
+        if (names == NULL) {
+            printf("Oops. Failed to grow the parts to %d.\n", s_parts);
+            exit(1);
+        }
     }
-    strcpy(parts[t_parts].name, name);
-    parts[t_parts].t_targets = 0;
+    names[t_parts] = name;
+    table[slot] = t_parts;
     t_parts++;
+    if (t_parts * 2 > table_size) {
+        table_grow();
+    }
     return t_parts - 1;
 }
 
 /*
- * Add the target entry, if necessary
+ * The wires as they're read (each one once, lowest part first), and
+ * then as adjacency lists in one array: the wires of part p are
+ * wires[first[p]] .. wires[first[p + 1] - 1]. Every wire is in there
+ * twice, once for each end, and reverse[] has the position of the
+ * other one.
  */
-void
-add_target(int p, int t)
-{
-    int t_t = parts[p].t_targets;
-    for (int i = 0; i < t_t; i++) {
-        if (parts[p].targets[i] == t) {
-            /* Already there. */
-            return;
-        }
-    }
-    parts[p].targets[t_t] = t;
-    parts[p].t_targets++;
-}
+struct wire {
+    int a, b;
+} *read_wires = NULL;
+int t_wires, s_wires;
 
-void
-dump_parts()
+int *first = NULL;
+int *wires = NULL;
+int *reverse = NULL;
+
+static void
+add_wire(int a, int b)
 {
-    for (int p = 0; p < t_parts; p++) {
-        printf("%s:", parts[p].name);
-        for (int t = 0; t < parts[p].t_targets; t++) {
-            int t_i = parts[p].targets[t];
-            printf(" %s", parts[t_i].name);
+    if (t_wires == s_wires) {
+        s_wires = s_wires ? s_wires * 2 : 4096;
+        read_wires = realloc(read_wires, s_wires * sizeof(struct wire));
+        if (read_wires == NULL) {
+            printf("Oops. Failed to grow the wires to %d.\n", s_wires);
+            exit(1);
         }
-        printf("\n");
     }
+    read_wires[t_wires].a = a < b ? a : b;
+    read_wires[t_wires].b = a < b ? b : a;
+    t_wires++;
 }
 
-/*
- * Clear the 'seen' flag for all parts
- */
-void
-mark_unseen()
+static int
+compare_wires(const void *w1, const void *w2)
 {
-    for (int p = 0; p < t_parts; p++) {
-        parts[p].seen = false;
-    }
-}
+    const struct wire *a = w1, *b = w2;
 
-int broken[3][2];
-
-/*
- * Check if we marked this edge as broken for this run
- */
-bool
-edge_broken(int p1, int p2)
-{
-    for (int i = 0; i < 3; i++) {
-        if (p1 == broken[i][0] && p2 == broken[i][1]) {
-            return true;
-        }
-        if (p1 == broken[i][1] && p2 == broken[i][0]) {
-            return true;
-        }
+    if (a->a != b->a) {
+        return a->a - b->a;
     }
-    return false;
+    return a->b - b->b;
 }
 
-/*
- * Data-structure and functions that maintain the queue for the breadth-first searches below
- */
-
-int queue[MAX_PARTS];
-int t_queue;
-
-void
-queue_init()
+static void
+build_adjacency()
 {
-    t_queue = 0;
-}
+    int total = 0;
 
-void
-queue_add(int p)
-{
-    /* Check for dupes */
-    for (int i = 0; i < t_queue; i++) {
-        if (queue[i] == p) {
-            return;
+    /* Drop the wires that were listed more than once */
+    qsort(read_wires, t_wires, sizeof(struct wire), compare_wires);
+    for (int w = 0; w < t_wires; w++) {
+        if (w == 0 || compare_wires(&read_wires[w], &read_wires[total - 1])) {
+            read_wires[total++] = read_wires[w];
         }
     }
-    if (t_queue == MAX_PARTS) {
-        printf("Need more space on the queue.\n");
+    t_wires = total;
+
+    first = calloc(t_parts + 1, sizeof(int));
+    wires = malloc((2 * t_wires + 1) * sizeof(int));
+    reverse = malloc((2 * t_wires + 1) * sizeof(int));
+    int *next = malloc((t_parts + 1) * sizeof(int));
+    if (first == NULL || wires == NULL || reverse == NULL || next == NULL) {
+        printf("Oops. Failed to allocate the adjacency lists.\n");
         exit(1);
     }
-    queue[t_queue] = p;
-    t_queue++;
+    for (int w = 0; w < t_wires; w++) {
+        first[read_wires[w].a + 1]++;
+        first[read_wires[w].b + 1]++;
+    }
+    for (int p = 0; p < t_parts; p++) {
+        first[p + 1] += first[p];
+        next[p] = first[p];
+    }
+    for (int w = 0; w < t_wires; w++) {
+        int a = read_wires[w].a, b = read_wires[w].b;
+        int at_a = next[a]++, at_b = next[b]++;
+
+        wires[at_a] = b;
+        wires[at_b] = a;
+        reverse[at_a] = at_b;
+        reverse[at_b] = at_a;
+    }
+    free(next);
 }
 
 /*
- * Breadth-First Search to calculate how many steps to cover the
- * entire network
+ * Every wire can carry one unit of flow, in either direction: flow[]
+ * has it for each end of a wire (1 going out, -1 coming in). The
+ * Breadth-First Search looks for a path from source to sink with room
+ * to spare, and follows it back to push one more unit along. The
+ * parts it reached are marked with the current visit number.
  */
-int
-calculate_network_distance(int p)
+int *flow = NULL;
+int *queue = NULL;
+int *via = NULL;
+int *visited = NULL;
+int visit;
+
+static bool
+augment(int source, int sink)
 {
-    mark_unseen();
-    int d = 0;
-
-    queue_init();
-    queue_add(p);
-    parts[p].seen = true;
-
-    while (t_queue > 0) {
-        int copy[MAX_PARTS];
-        int t_copy = t_queue;
-        queue_init();
-        memcpy(copy, queue, sizeof(queue));
-        for (int i = 0; i < t_copy; i++) {
-            int i_p = copy[i];
-            for (int t = 0; t < parts[i_p].t_targets; t++) {
-                int f = parts[i_p].targets[t];
-                if (parts[f].seen) {
-                    continue;
+    int head = 0, tail = 0;
+
+    visit++;
+    queue[tail++] = source;
+    visited[source] = visit;
+    while (head < tail) {
+        int p = queue[head++];
+
+        for (int w = first[p]; w < first[p + 1]; w++) {
+            int t = wires[w];
+
+            if (visited[t] == visit || flow[w] == 1) {
+                continue;
+            }
+            visited[t] = visit;
+            via[t] = w;
+            if (t == sink) {
+                for (int at = sink; at != source; at = wires[reverse[via[at]]]) {
+                    flow[via[at]]++;
+                    flow[reverse[via[at]]]--;
                 }
-                parts[f].seen = true;
-                queue_add(f);
+                return true;
             }
+            queue[tail++] = t;
         }
-        d++;
     }
-    parts[p].depth = d;
-    return d;
+    return false;
 }
 
 /*
- * Breadth-First Search to calculate the size of network (partition),
- * taking into account the edges that have been marked as broken.
+ * The maximum flow from source to sink (only counting up to one more
+ * than CUT_WIRES) is the smallest number of wires that separates the
+ * two. If that's no more than CUT_WIRES, they're on different sides,
+ * and the last search has marked the source's side.
  */
-int
-calculate_network_size(int p)
+static int
+max_flow(int source, int sink)
 {
-    mark_unseen();
-    int count = 1;
-    queue_init();
-    queue_add(p);
-    parts[p].seen = true;
-
-    while (t_queue > 0) {
-        int copy[MAX_PARTS];
-        int t_copy = t_queue;
-        queue_init();
-        memcpy(copy, queue, sizeof(queue));
-        for (int i = 0; i < t_copy; i++) {
-            int i_p = copy[i];
-            for (int t = 0; t < parts[i_p].t_targets; t++) {
-                int f = parts[i_p].targets[t];
-                if (edge_broken(i_p, f)) {
-                    continue;
-                }
-                if (parts[f].seen) {
-                    continue;
-                }
-                parts[f].seen = true;
-                count++;
-                queue_add(f);
-            }
-        }
+    int total = 0;
+
+    memset(flow, 0, 2 * t_wires * sizeof(int));
+    while (total <= CUT_WIRES && augment(source, sink)) {
+        total++;
     }
-    return count;
+    return total;
 }
 
 /*
- * Read from the filedescriptor (whether it's stdin or an actual file)
- * until we reach the end. Strip newlines, and then do what needs to
- * be done.
+ * Go through the lines of the input (the runtime has already stripped
+ * the newlines), and then do what needs to be done.
  */
 void
-process_file(FILE *fd)
+solve(struct aoc_input *in)
 {
-    char buf[MAX_LEN + 1];
+    t_parts = 0;
+    t_wires = 0;
+    table_size = 0;
+    table_grow();
+    for (size_t lineno = 0; lineno < in->count; lineno++) {
+        char *buf = in->lines[lineno].str;
 
-    init_parts();
-    while (NULL != fgets(buf, MAX_LEN, fd)) {
-        /* Strip the newline, if present */
-        if (buf[strlen(buf) - 1] == '\n') {
-            buf[strlen(buf) - 1] = '\0';
-        }
         if (opts.debug) {
-            unsigned char digest[SHA256_DIGEST_LENGTH];
-            char hexdigest[SHA256_DIGEST_LENGTH * 2 + 1];
-
-            SHA256((unsigned char *)buf, strlen(buf), digest);
-
-            for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-                sprintf(&hexdigest[i * 2], "%02x", (unsigned int)digest[i]);
-            }
-
-            printf("DEBUG: Line received: [%s] '%s'\n", hexdigest, buf);
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        if (!in->lines[lineno].len) {
+            continue;
         }
-        char name[10];
-        int len = 0;
-        sscanf(buf, "%[a-z]%n:", name, &len);
+        char *colon = strchr(buf, ':');
+        if (colon == NULL) {
+            printf("Oops. No component found in '%s'.\n", buf);
+            exit(1);
+        }
+        *colon = '\0';
         if (opts.debug) {
-            printf("Detected component '%s' - len = %d\n", name, len);
+            printf("Detected component '%s'\n", buf);
         }
 
-        int p = add_part(name);
+        int p = add_part(buf);
 
-        char *info = buf + len + 2;
-        while (strlen(info)) {
-            char target[10];
-            len = 0;
-            sscanf(info, "%[a-z]%n", target, &len);
-            int t = add_part(target);
-            add_target(p, t);
-            add_target(t, p);
-            if (opts.debug) {
-                printf("  Target '%s' - len = %d\n", target, len);
+        char *info = colon + 1;
+        while (*info) {
+            while (*info == ' ') {
+                info++;
             }
-            if (info[len] == '\0') {
+            if (!*info) {
                 break;
             }
-            info = info + len + 1;
+            char *target = info;
+            while (*info && *info != ' ') {
+                info++;
+            }
+            if (*info) {
+                *info++ = '\0';
+            }
+            if (opts.debug) {
+                printf("  Target '%s'\n", target);
+            }
+            add_wire(p, add_part(target));
         }
     }
     if (opts.debug) {
         printf("DEBUG: End of file\n");
     }
+    if (t_parts < 2) {
+        printf("Oops. Need at least two parts to split.\n");
+        exit(1);
+    }
+    build_adjacency();
     if (opts.debug || opts.verbose) {
-        printf("Total parts parsed: %d\n", t_parts);
+        printf("Total parts parsed: %d, with %d wires\n", t_parts, t_wires);
     }
-    if (opts.debug) {
-        dump_parts();
+
+    flow = malloc((2 * t_wires + 1) * sizeof(int));
+    queue = malloc(t_parts * sizeof(int));
+    via = malloc(t_parts * sizeof(int));
+    visited = calloc(t_parts, sizeof(int));
+    int *order = malloc(t_parts * sizeof(int));
+    if (flow == NULL || queue == NULL || via == NULL || visited == NULL || order == NULL) {
+        printf("Oops. Failed to allocate the search space.\n");
+        exit(1);
     }
+    visit = 0;
 
-    int min_depth = -1;
+    /*
+     * Keep part 0 as the source. The sink has to end up on the other
+     * side of the cut, which is more likely the further away from the
+     * source it is, so try those first: the reverse of the order in
+     * which a search from the source finds them (and the ones it
+     * doesn't find at all, before those).
+     */
+    int source = 0, found = 0;
+    memset(flow, 0, 2 * t_wires * sizeof(int));
+    augment(source, -1);
     for (int p = 0; p < t_parts; p++) {
-        int d = calculate_network_distance(p);
-        if (min_depth == -1 || d < min_depth) {
-            min_depth = d;
+        if (visited[p] != visit) {
+            order[found++] = p;
         }
-        if (opts.debug) {
-            printf("Network depth for %s: %d\n",
-                   parts[p].name, d);
+    }
+    for (int i = t_parts - found - 1; i > 0; i--) {
+        order[found++] = queue[i];
+    }
+
+    int cut = -1, tries = 0;
+    for (int i = 0; i < found && cut < 0; i++) {
+        tries++;
+        if (max_flow(source, order[i]) <= CUT_WIRES) {
+            cut = order[i];
         }
     }
     if (opts.debug || opts.verbose) {
-        printf("Prime targets (with the lowest network depth of %d):\n\n", min_depth);
+        printf("Tried %d sinks.\n", tries);
     }
-    t_cuts = 0;
+    if (cut < 0) {
+        printf("Oops. There's no way to split the parts by cutting %d wires.\n", CUT_WIRES);
+        exit(1);
+    }
+
+    printf("Cutting these wires does the trick:\n");
+    long count = 0;
     for (int p = 0; p < t_parts; p++) {
-        if (parts[p].depth == min_depth) {
-            if (opts.debug) {
-                printf("%s:", parts[p].name);
-            }
-            for (int t = 0; t < parts[p].t_targets; t++) {
-                int p_t = parts[p].targets[t];
-                if (opts.debug) {
-                    printf(" %s", parts[p_t].name);
-                }
-            }
-            if (opts.debug) {
-                printf("\n");
-            }
-            cuts[t_cuts] = p;
-            t_cuts++;
+        if (visited[p] != visit) {
+            continue;
         }
-    }
-    /*
-     * Look at all permutations of selecting three edges from the
-     * selected prime targets
-     */
-    int perms = 0;
-    for (int c1 = 0; c1 < t_cuts; c1++) {
-        int p1 = cuts[c1];
-        for (int c2 = c1 + 1; c2 < t_cuts; c2++) {
-            int p2 = cuts[c2];
-            for (int c3 = c2 + 1; c3 < t_cuts; c3++) {
-                int p3 = cuts[c3];
-                perms++;
-                if (opts.debug) {
-                    printf("Permutation %d: %s, %s, %s\n",
-                           perms,
-                           parts[p1].name,
-                           parts[p2].name,
-                           parts[p3].name);
-                }
-                for (int t1 = 0; t1 < parts[p1].t_targets; t1++) {
-                    int p4 = parts[p1].targets[t1];
-                    if (p4 == p2 || p4 == p3) {
-                        continue;
-                    }
-                    for (int t2 = 0; t2 < parts[p2].t_targets; t2++) {
-                        int p5 = parts[p2].targets[t2];
-                        if (p5 == p1 || p5 == p3 || p5 == p4) {
-                            continue;
-                        }
-                        for (int t3 = 0; t3 < parts[p3].t_targets; t3++) {
-                            int p6 = parts[p3].targets[t3];
-                            if (p6 == p1 || p6 == p2 || p6 == p4 || p6 == p5) {
-                                continue;
-                            }
-                            broken[0][0] = p1;
-                            broken[0][1] = p4;
-                            broken[1][0] = p2;
-                            broken[1][1] = p5;
-                            broken[2][0] = p3;
-                            broken[2][1] = p6;
-                            int count = calculate_network_size(p1);
-                            if (opts.debug) {
-                                printf("Testing cutting these wires:\n");
-                                printf("  %s - %s\n", parts[p1].name, parts[p4].name);
-                                printf("  %s - %s\n", parts[p2].name, parts[p5].name);
-                                printf("  %s - %s\n", parts[p3].name, parts[p6].name);
-                                printf("Network (partition) size: %d\n", count);
-                            }
-                            if (count < t_parts) {
-                                printf("Cutting these wires does the trick:\n");
-                                printf("  %s - %s\n", parts[p1].name, parts[p4].name);
-                                printf("  %s - %s\n", parts[p2].name, parts[p5].name);
-                                printf("  %s - %s\n", parts[p3].name, parts[p6].name);
-                                printf("\n");
-                                printf("%d * %d = %d\n", count, t_parts - count, count * (t_parts - count));
-                                return;
-                            }
-                        }
-                    }
-                }
+        count++;
+        for (int w = first[p]; w < first[p + 1]; w++) {
+            if (visited[wires[w]] != visit) {
+                printf("  %s - %s\n", names[p], names[wires[w]]);
             }
         }
     }
-}
-
-
-/*
- * Minimal option parsing. As it stands, the program actually only
- * does something for -d and -h, but it's the thought that counts?
- */
-void
-parse_options(int *argc, char **argv[])
-{
-    int ch;
-    char *argv0;
-
-    argv0 = (*argv)[0];
-
-    opts.debug   = false;
-    opts.dryrun  = false;
-    opts.verbose = false;
-
-    if (*argc == 1) {
-        /* What to do if there are no command line arguments */
-        *argc -= 1;
-        *argv += 1;
-        return;
-    }
-    while ((ch = getopt(*argc, *argv, "dnvh")) != -1) {
-        switch (ch) {
-        case 'd':
-            opts.debug = true;
-            break;
-        case 'n':
-            opts.dryrun = true;
-            break;
-        case 'v':
-            opts.verbose = true;
-            break;
-        case 'h':
-            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
-        case '?':
-        default:
-            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
-        }
-    }
-    *argc -= optind;
-    *argv += optind;
-#if 0
-    if (*argc > 0) {
-        /* What to do with the non-option parameters? */
-        print_usage(stderr, argv0, "Too many parameters provided.\n\n", false, EXIT_FAILURE);
-    }
-#endif
-}
-
-
-/*
- * Print a minimal usage blurb for the program.
- */
-void
-print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
-{
-    char *name;
-
-    if (prefix != NULL) {
-        fprintf(f, "%s", prefix);
-    }
-    name = basename(argv0);
-    fprintf(f, "\
-NAME\n\
-     %s - Program for AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) "\n \
-\n\
-SYNOPSIS\n\
-     %s [OPTIONS] [<filename> ...]\n",
-            name, name);
-    if (!full) {
-        exit(exitcode);
-    }
-    fprintf(f, "\
-\n\
-DESCRIPTION\n\
-     This program is used for one of the AoC " STR(YEAR) " puzzles; Day " STR(DAY) ", part " STR(PART) ".\n\
-     If filenames are provided, it will process them, one at a time.\n\
-     Otherwise it will process whatever it will read from standard input.\n\
-\n\
-OPTIONS\n\
-     -d\n\
-        Enable debugging output.\n\
-     -n\n\
-        Request dryrun (noop) mode.\n\
-     -v\n\
-        Enable verbose output.\n\
-\n\
-EXIT STATUS\n\
-     The program exits 0 on success, and 1 when something went amiss\n\
-     with its option parsing.\n");
-    exit(exitcode);
+    printf("\n");
+    printf("%ld * %ld = %ld\n", count, t_parts - count, count * (t_parts - count));
+
+    free(order);
+    free(flow);
+    free(queue);
+    free(via);
+    free(visited);
+    free(first);
+    free(wires);
+    free(reverse);
+    free(read_wires);
+    free(names);
+    free(table);
+    flow = queue = via = visited = NULL;
+    first = wires = reverse = NULL;
+    read_wires = NULL;
+    names = NULL;
+    table = NULL;
+    s_wires = s_parts = 0;
 }
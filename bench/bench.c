@@ -0,0 +1,529 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- for emacs
+ *
+ * =======================================================================
+ * Benchmark harness for the AoC programs
+ * =======================================================================
+ *
+ * Reads a manifest with one program run per line:
+ *
+ *     <label> <input file> <command> [<argument> ...]
+ *
+ * and runs every command a number of times (after some warmup runs),
+ * with the input file on stdin. For each of them it reports the
+ * min/median/p95 wall clock time, the maximum resident set size, and
+ * (on Linux, when perf_event_open() is allowed) the median number of
+ * instructions executed.
+ */
+
+# include <fcntl.h>      /* open()               */
+# include <libgen.h>     /* basename()           */
+# include <signal.h>     /* kill(), SIGKILL      */
+# include <stdbool.h>    /* bool, true, false    */
+# include <stdint.h>     /* uint64_t             */
+# include <stdio.h>      /* FILE, *printf(), etc */
+# include <stdlib.h>     /* exit(), qsort()      */
+# include <string.h>     /* strtok(), strerror() */
+# include <time.h>       /* clock_gettime()      */
+# include <unistd.h>     /* getopt(), fork()     */
+# include <sys/resource.h> /* struct rusage      */
+# include <sys/wait.h>   /* wait4()              */
+# include <sys/errno.h>  /* errno                */
+
+# ifdef __linux__
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# endif
+
+# define MAX_LEN  4096
+# define MAX_ARGS 32
+
+struct {
+    bool debug   : 1;
+    bool verbose : 1;
+    int  runs;
+    int  warmup;
+    int  timeout;
+    char *csv;
+    char *json;
+} opts;
+
+struct result {
+    char     label[MAX_LEN];
+    char     input[MAX_LEN];
+    int      runs;
+    int      failed;
+    double   min_ms;
+    double   median_ms;
+    double   p95_ms;
+    long     max_rss_kb;
+    bool     have_instructions;
+    uint64_t instructions;
+};
+
+struct result *results = NULL;
+int results_total = 0;
+
+
+void parse_options(int *argc, char **argv[]);
+void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+
+
+/*
+ * Set up a counter for the instructions executed (in user space) by
+ * the given process and its threads/children, starting at its exec().
+ * Returns -1 when that's not possible on this system.
+ */
+int
+open_instruction_counter(pid_t pid)
+{
+# ifdef __linux__
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled       = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    return syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+# else
+    return -1;
+# endif
+}
+
+
+/*
+ * Run the command once, with the input on stdin and its output thrown
+ * away. Returns false if it could not be run or didn't exit cleanly.
+ */
+bool
+run_once(char *argv[], char *input, double *ms, long *rss_kb, int64_t *instructions)
+{
+    struct timespec start, end;
+    struct rusage ru;
+    int go[2], status, counter;
+    pid_t pid;
+    char c = 0;
+
+    if (pipe(go) == -1) {
+        printf("Failed to create a pipe: %s\n", strerror(errno));
+        exit(1);
+    }
+    pid = fork();
+    if (pid == -1) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        exit(1);
+    }
+    if (pid == 0) {
+        int in_fd, null_fd;
+
+        close(go[1]);
+        in_fd = open(input, O_RDONLY);
+        null_fd = open("/dev/null", O_WRONLY);
+        if (in_fd == -1 || null_fd == -1) {
+            _exit(127);
+        }
+        dup2(in_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        if (!opts.debug) {
+            dup2(null_fd, STDERR_FILENO);
+        }
+        /* Wait until the parent has the counter set up */
+        if (read(go[0], &c, 1) != 1) {
+            _exit(127);
+        }
+        if (opts.timeout > 0) {
+            alarm(opts.timeout);
+        }
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(go[0]);
+    counter = open_instruction_counter(pid);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (write(go[1], &c, 1) != 1) {
+        kill(pid, SIGKILL);
+    }
+    close(go[1]);
+    while (wait4(pid, &status, 0, &ru) == -1) {
+        if (errno != EINTR) {
+            printf("Failed to wait for '%s': %s\n", argv[0], strerror(errno));
+            exit(1);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+# ifdef __APPLE__
+    *rss_kb = ru.ru_maxrss / 1024;
+# else
+    *rss_kb = ru.ru_maxrss;
+# endif
+    *instructions = -1;
+    if (counter != -1) {
+        uint64_t count;
+
+        if (read(counter, &count, sizeof(count)) == sizeof(count)) {
+            *instructions = count;
+        }
+        close(counter);
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+
+int
+compare_doubles(const void *a, const void *b)
+{
+    double d1 = *((double *)a);
+    double d2 = *((double *)b);
+
+    return (d1 > d2) - (d1 < d2);
+}
+
+
+int
+compare_counts(const void *a, const void *b)
+{
+    int64_t c1 = *((int64_t *)a);
+    int64_t c2 = *((int64_t *)b);
+
+    return (c1 > c2) - (c1 < c2);
+}
+
+
+/*
+ * Nearest-rank percentile of a sorted array.
+ */
+double
+percentile(double *sorted, int total, int pct)
+{
+    int rank = (pct * total + 99) / 100;
+
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+
+/*
+ * Do the warmup and measured runs for one manifest entry.
+ */
+void
+bench_entry(char *label, char *input, char *argv[])
+{
+    double times[opts.runs];
+    int64_t counts[opts.runs];
+    struct result *r;
+    int measured = 0;
+
+    results = realloc(results, (results_total + 1) * sizeof(struct result));
+    if (results == NULL) {
+        printf("Oops. Failed to allocate the results.\n");
+        exit(1);
+    }
+    r = &results[results_total++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->label, sizeof(r->label), "%s", label);
+    snprintf(r->input, sizeof(r->input), "%s", input);
+    r->have_instructions = true;
+
+    if (opts.verbose) {
+        fprintf(stderr, "Running %s < %s\n", label, input);
+    }
+    for (int i = 0; i < opts.warmup + opts.runs; i++) {
+        double ms;
+        long rss_kb;
+        int64_t instructions;
+
+        if (!run_once(argv, input, &ms, &rss_kb, &instructions)) {
+            r->failed++;
+            if (opts.verbose) {
+                fprintf(stderr, "  Run %d of %s failed.\n", i + 1, label);
+            }
+            /* No point in keeping at it */
+            if (i == 0) {
+                break;
+            }
+            continue;
+        }
+        if (i < opts.warmup) {
+            continue;
+        }
+        times[measured] = ms;
+        counts[measured] = instructions;
+        if (instructions < 0) {
+            r->have_instructions = false;
+        }
+        if (rss_kb > r->max_rss_kb) {
+            r->max_rss_kb = rss_kb;
+        }
+        measured++;
+    }
+    r->runs = measured;
+    if (measured == 0) {
+        r->have_instructions = false;
+        return;
+    }
+    qsort(times, measured, sizeof(double), compare_doubles);
+    qsort(counts, measured, sizeof(int64_t), compare_counts);
+    r->min_ms = times[0];
+    r->median_ms = percentile(times, measured, 50);
+    r->p95_ms = percentile(times, measured, 95);
+    r->instructions = counts[(measured - 1) / 2];
+}
+
+
+/*
+ * Go through the manifest, one run specification per line.
+ */
+void
+process_manifest(FILE *fd)
+{
+    char buf[MAX_LEN + 1];
+
+    while (NULL != fgets(buf, MAX_LEN, fd)) {
+        char *argv[MAX_ARGS + 1];
+        char *label, *input;
+        int argc = 0;
+
+        /* Strip the newline, if present */
+        if (buf[strlen(buf) - 1] == '\n') {
+            buf[strlen(buf) - 1] = '\0';
+        }
+        if (opts.debug) {
+            printf("DEBUG: Line received: '%s'\n", buf);
+        }
+        label = strtok(buf, " \t");
+        input = strtok(NULL, " \t");
+        if (label == NULL || label[0] == '#') {
+            continue;
+        }
+        while (argc < MAX_ARGS && (argv[argc] = strtok(NULL, " \t")) != NULL) {
+            argc++;
+        }
+        argv[argc] = NULL;
+        if (input == NULL || argc == 0) {
+            printf("Skipping incomplete manifest entry '%s'.\n", label);
+            continue;
+        }
+        bench_entry(label, input, argv);
+    }
+}
+
+
+void
+print_table(void)
+{
+    printf("%-28s %10s %10s %10s %10s %14s %5s\n",
+           "PROGRAM", "MIN ms", "MEDIAN ms", "P95 ms", "MAXRSS KB", "INSTRUCTIONS", "FAIL");
+    for (int i = 0; i < results_total; i++) {
+        struct result *r = &results[i];
+        char instr[32];
+
+        if (r->have_instructions) {
+            snprintf(instr, sizeof(instr), "%llu", (unsigned long long)r->instructions);
+        } else {
+            snprintf(instr, sizeof(instr), "-");
+        }
+        if (r->runs == 0) {
+            printf("%-28s %10s %10s %10s %10s %14s %5d\n",
+                   r->label, "-", "-", "-", "-", instr, r->failed);
+            continue;
+        }
+        printf("%-28s %10.3f %10.3f %10.3f %10ld %14s %5d\n",
+               r->label, r->min_ms, r->median_ms, r->p95_ms, r->max_rss_kb, instr, r->failed);
+    }
+}
+
+
+void
+write_csv(char *path)
+{
+    FILE *f = fopen(path, "w");
+
+    if (f == NULL) {
+        printf("Failed to write '%s': %s\n", path, strerror(errno));
+        return;
+    }
+    fprintf(f, "program,input,runs,failed,min_ms,median_ms,p95_ms,max_rss_kb,instructions\n");
+    for (int i = 0; i < results_total; i++) {
+        struct result *r = &results[i];
+
+        fprintf(f, "%s,%s,%d,%d,", r->label, r->input, r->runs, r->failed);
+        if (r->runs > 0) {
+            fprintf(f, "%.3f,%.3f,%.3f,%ld,", r->min_ms, r->median_ms, r->p95_ms, r->max_rss_kb);
+        } else {
+            fprintf(f, ",,,,");
+        }
+        if (r->have_instructions) {
+            fprintf(f, "%llu", (unsigned long long)r->instructions);
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+
+void
+write_json(char *path)
+{
+    FILE *f = fopen(path, "w");
+
+    if (f == NULL) {
+        printf("Failed to write '%s': %s\n", path, strerror(errno));
+        return;
+    }
+    fprintf(f, "[\n");
+    for (int i = 0; i < results_total; i++) {
+        struct result *r = &results[i];
+
+        fprintf(f, "  { \"program\": \"%s\", \"input\": \"%s\", \"runs\": %d, \"failed\": %d",
+                r->label, r->input, r->runs, r->failed);
+        if (r->runs > 0) {
+            fprintf(f, ", \"min_ms\": %.3f, \"median_ms\": %.3f, \"p95_ms\": %.3f, \"max_rss_kb\": %ld",
+                    r->min_ms, r->median_ms, r->p95_ms, r->max_rss_kb);
+        }
+        if (r->have_instructions) {
+            fprintf(f, ", \"instructions\": %llu", (unsigned long long)r->instructions);
+        }
+        fprintf(f, " }%s\n", i + 1 < results_total ? "," : "");
+    }
+    fprintf(f, "]\n");
+    fclose(f);
+}
+
+
+int
+main(int argc, char *argv[], char *env[])
+{
+    parse_options(&argc, &argv);
+
+    if (argc == 0) {
+        process_manifest(stdin);
+    }
+    for (int i = 0; i < argc; i++) {
+        FILE *fd = fopen(argv[i], "r");
+
+        if (fd == NULL) {
+            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
+            return 1;
+        }
+        process_manifest(fd);
+        fclose(fd);
+    }
+    print_table();
+    if (opts.csv != NULL) {
+        write_csv(opts.csv);
+    }
+    if (opts.json != NULL) {
+        write_json(opts.json);
+    }
+    return 0;
+}
+
+
+void
+parse_options(int *argc, char **argv[])
+{
+    int ch;
+
+    opts.debug   = false;
+    opts.verbose = false;
+    opts.runs    = 10;
+    opts.warmup  = 2;
+    opts.timeout = 0;
+    opts.csv     = NULL;
+    opts.json    = NULL;
+
+    while ((ch = getopt(*argc, *argv, "c:dj:r:t:vw:h")) != -1) {
+        switch (ch) {
+        case 'c':
+            opts.csv = optarg;
+            break;
+        case 'd':
+            opts.debug = true;
+            break;
+        case 'j':
+            opts.json = optarg;
+            break;
+        case 'r':
+            opts.runs = atoi(optarg);
+            break;
+        case 't':
+            opts.timeout = atoi(optarg);
+            break;
+        case 'v':
+            opts.verbose = true;
+            break;
+        case 'w':
+            opts.warmup = atoi(optarg);
+            break;
+        case 'h':
+            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
+        case '?':
+        default:
+            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
+        }
+    }
+    if (opts.runs < 1 || opts.warmup < 0) {
+        print_usage(stderr, (*argv)[0], "Need at least one run, and no negative warmup.\n\n",
+                    false, EXIT_FAILURE);
+    }
+    *argc -= optind;
+    *argv += optind;
+}
+
+
+void
+print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
+{
+    char *name;
+
+    if (prefix != NULL) {
+        fprintf(f, "%s", prefix);
+    }
+    name = basename(argv0);
+    fprintf(f, "\
+NAME\n\
+     %s - Benchmark harness for the AoC programs\n\
+\n\
+SYNOPSIS\n\
+     %s [OPTIONS] [<manifest> ...]\n",
+            name, name);
+    if (!full) {
+        exit(exitcode);
+    }
+    fprintf(f, "\
+\n\
+DESCRIPTION\n\
+     Runs the programs listed in the manifest(s) (or read from standard\n\
+     input), one per line as: <label> <input file> <command> [<arg> ...]\n\
+     and prints a table with the timings for each of them.\n\
+\n\
+OPTIONS\n\
+     -c <file>\n\
+        Also write the results to <file> as CSV.\n\
+     -d\n\
+        Enable debugging output (and leave the programs' stderr alone).\n\
+     -j <file>\n\
+        Also write the results to <file> as JSON.\n\
+     -r <runs>\n\
+        Number of measured runs per program (default 10).\n\
+     -t <seconds>\n\
+        Kill runs that take longer than this (default: no limit).\n\
+     -v\n\
+        Enable verbose output.\n\
+     -w <runs>\n\
+        Number of warmup runs per program (default 2).\n\
+\n\
+EXIT STATUS\n\
+     The program exits 0 on success, and 1 when something went amiss\n\
+     with its option parsing.\n");
+    exit(exitcode);
+}
@@ -0,0 +1,1154 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- for emacs
+ *
+ * =======================================================================
+ * Shared runtime for the C AoC programs (libaoc)
+ * =======================================================================
+ */
+
+# include <fcntl.h>      /* open()               */
+# include <libgen.h>     /* basename()           */
+# include <limits.h>     /* PATH_MAX             */
+# include <pthread.h>    /* pthread_create()     */
+# include <stdbool.h>    /* bool, true, false    */
+# include <stdio.h>      /* FILE, *printf(), etc */
+# include <stdlib.h>     /* exit()               */
+# include <string.h>     /* strerror(), memchr() */
+# include <time.h>       /* clock_gettime()      */
+# include <unistd.h>     /* getopt(), read()     */
+# include <sys/mman.h>   /* mmap()               */
+# include <sys/stat.h>   /* stat()               */
+# include <sys/errno.h>  /* errno                */
+
+# include <openssl/evp.h>
+
+# include "aoc.h"
+
+struct aoc_opts opts;
+
+static char *program_path;
+
+/* Where solve() is writing to while its output is being cached */
+static struct {
+    bool active;
+    int  saved_fd;
+    char tmp_path[PATH_MAX];
+} capture;
+
+/*
+ * Where a streaming program is in its input: the chunk that was read
+ * last, and how much of it was handed out already. A token that
+ * doesn't end in the chunk it starts in is collected in token.
+ */
+struct aoc_stream {
+    int          fd;
+    char        *chunk;
+    size_t       len;
+    size_t       pos;
+    bool         eof;
+    EVP_MD_CTX  *ctx;           /* When the digest is fed while reading */
+    const char  *seps;          /* What is_sep[] was set up for */
+    bool         is_sep[256];
+    char        *token;
+    size_t       token_len;
+    size_t       token_size;
+};
+
+/*
+ * What aoc_parallel_for() is working on.
+ */
+static struct {
+    long              total;
+    long              chunk;
+    long              next;
+    void           *(*init)(void);
+    bool            (*fn)(void *scratch, long from, long to);
+    void            (*reduce)(void *scratch);
+    void            (*fini)(void *scratch);
+    pthread_mutex_t   lock;
+} parallel = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+
+static void parse_options(int *argc, char **argv[]);
+static void print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode);
+static bool load_input(int fd, struct aoc_input *in);
+static bool open_stream(int fd, struct aoc_input *in);
+static bool fill_chunk(struct aoc_input *in);
+static bool want_digest(void);
+static void finish_digest(EVP_MD_CTX *ctx, struct aoc_input *in);
+static void hex_digest(const unsigned char *digest, char *hex);
+static bool cache_enabled(void);
+static bool cache_entry(struct aoc_input *in, char *path, size_t size);
+static bool cache_replay(const char *entry);
+static bool cache_store(const char *entry, const char *name);
+static bool capture_start(const char *entry);
+static char *capture_stop(size_t *len);
+static void capture_abort(void);
+static char *read_file(const char *path, size_t *len);
+static void index_lines(struct aoc_input *in);
+static void release_input(struct aoc_input *in);
+static void release_stream(struct aoc_input *in);
+static void *parallel_worker(void *arg);
+static bool run_solve(int fd, const char *name);
+
+
+/*
+ * Main code block which checks the options and either read files (if
+ * provided after the options), or whatever is fed to it on stdin,
+ * calling the program's solve() for it.
+ */
+int
+main(int argc, char *argv[], char *env[])
+{
+    program_path = argv[0];
+    parse_options(&argc, &argv);
+    atexit(capture_abort);
+
+    if (argc == 0) {
+        if (opts.debug) {
+            printf("Processing data from stdin.\n");
+        }
+        return run_solve(STDIN_FILENO, "stdin") ? 0 : 1;
+    }
+    for (int i = 0; i < argc; i++) {
+        struct stat st;
+        int fd;
+
+        if (stat(argv[i], &st)) {
+            printf("File not found: '%s'\n", argv[i]);
+            return 1;
+        }
+
+        if (opts.debug) {
+            printf("Opening %s for reading.\n", argv[i]);
+        }
+        fd = open(argv[i], O_RDONLY);
+        if (fd == -1) {
+            printf("Failed to open '%s': %d (%s)\n", argv[i], errno, strerror(errno));
+            return 1;
+        }
+        if (opts.debug) {
+            printf("Processing data from '%s'.\n", argv[i]);
+        }
+        if (!run_solve(fd, argv[i])) {
+            close(fd);
+            return 1;
+        }
+        close(fd);
+    }
+    return 0;
+}
+
+
+/*
+ * Milliseconds between two clock_gettime() readings.
+ */
+static double
+elapsed_ms(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+
+/*
+ * Load one input and call solve() for it, reporting the wall clock
+ * time it took on stderr when -t was given, so it doesn't mix with
+ * the answers.
+ *
+ * If this program has seen the same input (with the same options)
+ * before, the output from back then is replayed from the cache rather
+ * than calling solve() again, unless -C or -V was given.
+ */
+static bool
+run_solve(int fd, const char *name)
+{
+    struct aoc_input in = { .name = name };
+    struct timespec start, loaded, end;
+    char entry[PATH_MAX];
+    bool caching, digested, ok = true;
+
+    if (opts.timing) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    }
+    if (!(aoc_program.stream ? open_stream(fd, &in) : load_input(fd, &in))) {
+        printf("Failed to read '%s': %d (%s)\n", name, errno, strerror(errno));
+        return false;
+    }
+    if (!aoc_program.stream) {
+        index_lines(&in);
+    }
+    if (opts.timing) {
+        clock_gettime(CLOCK_MONOTONIC, &loaded);
+    }
+    digested = in.digested;
+    if (opts.fingerprint && digested) {
+        fflush(stdout);
+        fprintf(stderr, "Fingerprint of '%s': %s\n", name, in.hexdigest);
+    }
+    caching = cache_enabled() && cache_entry(&in, entry, sizeof(entry));
+    if (caching && !opts.verify && cache_replay(entry)) {
+        if (opts.timing) {
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            fflush(stdout);
+            fprintf(stderr, "Time for '%s': %.3f ms (from the cache)\n", name,
+                    elapsed_ms(&start, &end));
+        }
+        release_input(&in);
+        return true;
+    }
+    if (caching) {
+        caching = capture_start(entry);
+    }
+    solve(&in);
+    if (opts.timing) {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+    }
+    if (caching) {
+        ok = cache_store(entry, name);
+    }
+    if (opts.fingerprint && !digested) {
+        /* Streamed from a pipe, the digest was fed along the way */
+        while (fill_chunk(&in)) {
+            ;
+        }
+        fflush(stdout);
+        fprintf(stderr, "Fingerprint of '%s': %s\n", name, in.hexdigest);
+    }
+    if (opts.timing) {
+        fflush(stdout);
+        fprintf(stderr, "Time for '%s': %.3f ms (loading the input: %.3f ms)\n", name,
+                elapsed_ms(&start, &end), elapsed_ms(&start, &loaded));
+    }
+    release_input(&in);
+    return ok;
+}
+
+
+/*
+ * The fingerprint of an input is only calculated when it's going to
+ * be used, as it means hashing every byte of it.
+ */
+static bool
+want_digest(void)
+{
+    return opts.fingerprint || cache_enabled();
+}
+
+
+/*
+ * Get the whole input into memory, with room for a '\0' after the
+ * last byte. Regular files are mapped privately (copy-on-write), so
+ * index_lines() can terminate the lines in place without touching
+ * the file itself. Anything else (pipes, terminals), or a file that
+ * exactly fills its last page without a trailing newline, is read
+ * in bulk into a buffer instead.
+ *
+ * When the fingerprint is wanted, the digest is fed while the data
+ * comes in (or in one go over the mapping), before index_lines()
+ * changes the newlines.
+ */
+static bool
+load_input(int fd, struct aoc_input *in)
+{
+    struct stat st;
+    size_t alloc;
+    EVP_MD_CTX *ctx = NULL;
+
+    if (fstat(fd, &st) == -1) {
+        return false;
+    }
+    if (want_digest()) {
+        ctx = EVP_MD_CTX_new();
+        if (ctx == NULL || !EVP_DigestInit_ex(ctx, EVP_sha256(), NULL)) {
+            printf("Oops. Failed to set up the SHA-256 digest.\n");
+            exit(1);
+        }
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        long pagesize = sysconf(_SC_PAGESIZE);
+        char *data;
+
+        data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            if (data[st.st_size - 1] == '\n' || st.st_size % pagesize != 0) {
+                in->data = data;
+                in->size = st.st_size;
+                in->mapped = true;
+                if (ctx != NULL) {
+                    EVP_DigestUpdate(ctx, in->data, in->size);
+                    finish_digest(ctx, in);
+                }
+                return true;
+            }
+            munmap(data, st.st_size);
+        }
+    }
+
+    alloc = S_ISREG(st.st_mode) ? st.st_size + 1 : 65536;
+    in->data = malloc(alloc);
+    in->size = 0;
+    in->mapped = false;
+    if (in->data == NULL) {
+        EVP_MD_CTX_free(ctx);
+        return false;
+    }
+    while (true) {
+        ssize_t got;
+
+        if (in->size + 1 == alloc) {
+            char *data = realloc(in->data, alloc * 2);
+
+            if (data == NULL) {
+                free(in->data);
+                EVP_MD_CTX_free(ctx);
+                return false;
+            }
+            in->data = data;
+            alloc *= 2;
+        }
+        got = read(fd, in->data + in->size, alloc - in->size - 1);
+        if (got == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(in->data);
+            EVP_MD_CTX_free(ctx);
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+        if (ctx != NULL) {
+            EVP_DigestUpdate(ctx, in->data + in->size, got);
+        }
+        in->size += got;
+    }
+    in->data[in->size] = '\0';
+    if (ctx != NULL) {
+        finish_digest(ctx, in);
+    }
+    return true;
+}
+
+
+/*
+ * Set up a streaming program's input, without reading any of it yet.
+ * When the fingerprint is wanted, a file is read through once for it
+ * up front (so the cache can be used), and then rewound. Anything that
+ * can't be rewound gets the digest fed while solve() reads it, so it's
+ * only known afterwards, and isn't cached.
+ */
+static bool
+open_stream(int fd, struct aoc_input *in)
+{
+    struct aoc_stream *s;
+    struct stat st;
+    off_t start;
+
+    if (fstat(fd, &st) == -1) {
+        return false;
+    }
+    s = calloc(1, sizeof(struct aoc_stream));
+    if (s == NULL || (s->chunk = malloc(AOC_CHUNK_SIZE + 1)) == NULL) {
+        printf("Oops. Failed to allocate the input chunk.\n");
+        exit(1);
+    }
+    s->fd = fd;
+    in->stream = s;
+    in->data = NULL;
+    in->size = 0;
+    in->lines = NULL;
+    in->count = 0;
+    in->mapped = false;
+    if (!want_digest()) {
+        return true;
+    }
+
+    s->ctx = EVP_MD_CTX_new();
+    if (s->ctx == NULL || !EVP_DigestInit_ex(s->ctx, EVP_sha256(), NULL)) {
+        printf("Oops. Failed to set up the SHA-256 digest.\n");
+        exit(1);
+    }
+    start = lseek(fd, 0, SEEK_CUR);
+    if (!S_ISREG(st.st_mode) || start == -1) {
+        return true;
+    }
+    while (true) {
+        ssize_t got = read(fd, s->chunk, AOC_CHUNK_SIZE);
+
+        if (got == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            release_stream(in);
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+        EVP_DigestUpdate(s->ctx, s->chunk, got);
+    }
+    finish_digest(s->ctx, in);
+    s->ctx = NULL;
+    if (lseek(fd, start, SEEK_SET) == -1) {
+        release_stream(in);
+        return false;
+    }
+    return true;
+}
+
+
+/*
+ * Read the next chunk of a streamed input, feeding the digest if it's
+ * being calculated along the way. Returns false at the end.
+ */
+static bool
+fill_chunk(struct aoc_input *in)
+{
+    struct aoc_stream *s = in->stream;
+    ssize_t got;
+
+    if (s->eof) {
+        return false;
+    }
+    do {
+        got = read(s->fd, s->chunk, AOC_CHUNK_SIZE);
+    } while (got == -1 && errno == EINTR);
+    if (got == -1) {
+        printf("Oops. Failed to read '%s': %d (%s)\n", in->name, errno, strerror(errno));
+        exit(1);
+    }
+    if (got == 0) {
+        s->eof = true;
+        s->len = s->pos = 0;
+        if (s->ctx != NULL) {
+            finish_digest(s->ctx, in);
+            s->ctx = NULL;
+        }
+        return false;
+    }
+    if (s->ctx != NULL) {
+        EVP_DigestUpdate(s->ctx, s->chunk, got);
+    }
+    s->chunk[got] = '\0';
+    s->len = got;
+    s->pos = 0;
+    in->size += got;
+    return true;
+}
+
+
+/*
+ * Hand out what's left of the current chunk, or the next one.
+ */
+size_t
+aoc_read(struct aoc_input *in, char **chunk)
+{
+    struct aoc_stream *s = in->stream;
+    size_t len;
+
+    if (s->pos == s->len && !fill_chunk(in)) {
+        return 0;
+    }
+    *chunk = s->chunk + s->pos;
+    len = s->len - s->pos;
+    s->pos = s->len;
+    return len;
+}
+
+
+/*
+ * Add a piece of a token that didn't end in its chunk to the ones
+ * collected so far, keeping room for the '\0'.
+ */
+static void
+token_append(struct aoc_stream *s, const char *piece, size_t len)
+{
+    if (s->token_len + len + 1 > s->token_size) {
+        while (s->token_len + len + 1 > s->token_size) {
+            s->token_size = s->token_size ? s->token_size * 2 : 256;
+        }
+        s->token = realloc(s->token, s->token_size);
+        if (s->token == NULL) {
+            printf("Oops. Failed to grow the token to %zu.\n", s->token_size);
+            exit(1);
+        }
+    }
+    memcpy(s->token + s->token_len, piece, len);
+    s->token_len += len;
+    s->token[s->token_len] = '\0';
+}
+
+
+/*
+ * Find the next separator, collecting the token on the way when it
+ * runs into the next chunk.
+ */
+bool
+aoc_token(struct aoc_input *in, const char *seps, struct aoc_line *token)
+{
+    struct aoc_stream *s = in->stream;
+
+    if (s->seps != seps) {
+        memset(s->is_sep, 0, sizeof(s->is_sep));
+        for (const char *p = seps; *p; p++) {
+            s->is_sep[(unsigned char)*p] = true;
+        }
+        s->seps = seps;
+    }
+    s->token_len = 0;
+    while (true) {
+        if (s->pos == s->len && !fill_chunk(in)) {
+            if (s->token_len == 0) {
+                return false;
+            }
+            token->str = s->token;
+            token->len = s->token_len;
+            return true;
+        }
+
+        char *start = s->chunk + s->pos;
+        char *end = s->chunk + s->len;
+        char *p = start;
+
+        while (p < end && !s->is_sep[(unsigned char)*p]) {
+            p++;
+        }
+        if (p == end) {
+            token_append(s, start, end - start);
+            s->pos = s->len;
+            continue;
+        }
+        *p = '\0';
+        s->pos = p + 1 - s->chunk;
+        if (s->token_len == 0) {
+            token->str = start;
+            token->len = p - start;
+        } else {
+            token_append(s, start, p - start);
+            token->str = s->token;
+            token->len = s->token_len;
+        }
+        return true;
+    }
+}
+
+
+/*
+ * Store the digest (and its hex form) in the input, and clean up.
+ */
+static void
+finish_digest(EVP_MD_CTX *ctx, struct aoc_input *in)
+{
+    EVP_DigestFinal_ex(ctx, in->digest, NULL);
+    EVP_MD_CTX_free(ctx);
+    hex_digest(in->digest, in->hexdigest);
+    in->digested = true;
+}
+
+
+/*
+ * Turn a digest into a '\0' terminated string of hex digits.
+ */
+static void
+hex_digest(const unsigned char *digest, char *hex)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    for (int i = 0; i < AOC_DIGEST_LENGTH; i++) {
+        hex[i * 2]     = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 0xf];
+    }
+    hex[AOC_DIGEST_LENGTH * 2] = '\0';
+}
+
+
+/*
+ * The output of debug runs isn't worth keeping (and would make the
+ * cache entries huge), so those always call solve().
+ */
+static bool
+cache_enabled(void)
+{
+    return !opts.nocache && !opts.debug;
+}
+
+
+/*
+ * Create a directory and any missing parents, like mkdir -p.
+ */
+static bool
+make_dirs(char *path)
+{
+    for (char *p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(path, 0755) == -1 && errno != EEXIST) {
+                *p = '/';
+                return false;
+            }
+            *p = '/';
+        }
+    }
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+
+/*
+ * Identify the program itself by a digest of its executable, so a
+ * rebuild after changing the code doesn't get the old answers.
+ */
+static bool
+program_digest(char *hex)
+{
+    static char digest_hex[AOC_DIGEST_LENGTH * 2 + 1];
+    unsigned char digest[AOC_DIGEST_LENGTH];
+    char buf[65536];
+    EVP_MD_CTX *ctx;
+    ssize_t got;
+    int fd;
+
+    if (digest_hex[0] != '\0') {
+        strcpy(hex, digest_hex);
+        return true;
+    }
+    fd = open("/proc/self/exe", O_RDONLY);
+    if (fd == -1) {
+        fd = open(program_path, O_RDONLY);
+    }
+    if (fd == -1) {
+        return false;
+    }
+    ctx = EVP_MD_CTX_new();
+    if (ctx == NULL || !EVP_DigestInit_ex(ctx, EVP_sha256(), NULL)) {
+        printf("Oops. Failed to set up the SHA-256 digest.\n");
+        exit(1);
+    }
+    while ((got = read(fd, buf, sizeof(buf))) > 0) {
+        EVP_DigestUpdate(ctx, buf, got);
+    }
+    close(fd);
+    EVP_DigestFinal_ex(ctx, digest, NULL);
+    EVP_MD_CTX_free(ctx);
+    if (got == -1) {
+        return false;
+    }
+    hex_digest(digest, digest_hex);
+    strcpy(hex, digest_hex);
+    return true;
+}
+
+
+/*
+ * Work out the path of the cache entry for this input. The key is a
+ * digest over the puzzle, the program's executable, the options that
+ * change the output, and the input's fingerprint. The entries live in
+ * $AOC_CACHE_DIR, or in aoc/ under the user's cache directory.
+ */
+static bool
+cache_entry(struct aoc_input *in, char *path, size_t size)
+{
+    char dir[PATH_MAX];
+    char program[AOC_DIGEST_LENGTH * 2 + 1];
+    char key[AOC_DIGEST_LENGTH * 2 + 1];
+    unsigned char digest[AOC_DIGEST_LENGTH];
+    char options[3], *p = options;
+    EVP_MD_CTX *ctx;
+    char *env;
+
+    if (!in->digested || !program_digest(program)) {
+        return false;
+    }
+    if ((env = getenv("AOC_CACHE_DIR")) != NULL && *env) {
+        snprintf(dir, sizeof(dir), "%s", env);
+    } else if ((env = getenv("XDG_CACHE_HOME")) != NULL && *env) {
+        snprintf(dir, sizeof(dir), "%s/aoc", env);
+    } else if ((env = getenv("HOME")) != NULL && *env) {
+        snprintf(dir, sizeof(dir), "%s/.cache/aoc", env);
+    } else {
+        return false;
+    }
+    if (!make_dirs(dir)) {
+        if (opts.verbose) {
+            fprintf(stderr, "Not caching results, failed to create '%s': %s\n",
+                    dir, strerror(errno));
+        }
+        return false;
+    }
+
+    if (opts.dryrun) {
+        *p++ = 'n';
+    }
+    if (opts.verbose) {
+        *p++ = 'v';
+    }
+    *p = '\0';
+    ctx = EVP_MD_CTX_new();
+    if (ctx == NULL || !EVP_DigestInit_ex(ctx, EVP_sha256(), NULL)) {
+        printf("Oops. Failed to set up the SHA-256 digest.\n");
+        exit(1);
+    }
+    EVP_DigestUpdate(ctx, aoc_program.year, strlen(aoc_program.year) + 1);
+    EVP_DigestUpdate(ctx, aoc_program.day, strlen(aoc_program.day) + 1);
+    EVP_DigestUpdate(ctx, aoc_program.part, strlen(aoc_program.part) + 1);
+    EVP_DigestUpdate(ctx, program, strlen(program) + 1);
+    EVP_DigestUpdate(ctx, options, strlen(options) + 1);
+    EVP_DigestUpdate(ctx, in->digest, AOC_DIGEST_LENGTH);
+    EVP_DigestFinal_ex(ctx, digest, NULL);
+    EVP_MD_CTX_free(ctx);
+    hex_digest(digest, key);
+
+    snprintf(path, size, "%s/%s-%s-%s-%s", dir,
+             aoc_program.year, aoc_program.day, aoc_program.part, key);
+    return true;
+}
+
+
+/*
+ * Write all of a buffer to a file descriptor.
+ */
+static bool
+write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t done = write(fd, buf, len);
+
+        if (done == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += done;
+        len -= done;
+    }
+    return true;
+}
+
+
+/*
+ * Read a whole (small) file into a freshly allocated buffer.
+ */
+static char *
+read_file(const char *path, size_t *len)
+{
+    struct stat st;
+    char *buf;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+    if (fstat(fd, &st) == -1 || (buf = malloc(st.st_size + 1)) == NULL) {
+        close(fd);
+        return NULL;
+    }
+    *len = 0;
+    while (*len < st.st_size) {
+        ssize_t got = read(fd, buf + *len, st.st_size - *len);
+
+        if (got <= 0) {
+            break;
+        }
+        *len += got;
+    }
+    close(fd);
+    return buf;
+}
+
+
+/*
+ * Print the output stored in a cache entry, if there is one.
+ */
+static bool
+cache_replay(const char *entry)
+{
+    size_t len;
+    char *output = read_file(entry, &len);
+
+    if (output == NULL) {
+        return false;
+    }
+    fflush(stdout);
+    write_all(STDOUT_FILENO, output, len);
+    free(output);
+    return true;
+}
+
+
+/*
+ * Point stdout at a temporary file next to the cache entry, so all
+ * that solve() prints ends up there.
+ */
+static bool
+capture_start(const char *entry)
+{
+    int fd;
+
+    snprintf(capture.tmp_path, sizeof(capture.tmp_path), "%s.XXXXXX", entry);
+    fd = mkstemp(capture.tmp_path);
+    if (fd == -1) {
+        return false;
+    }
+    fflush(stdout);
+    capture.saved_fd = dup(STDOUT_FILENO);
+    if (capture.saved_fd == -1 || dup2(fd, STDOUT_FILENO) == -1) {
+        close(fd);
+        unlink(capture.tmp_path);
+        return false;
+    }
+    close(fd);
+    capture.active = true;
+    return true;
+}
+
+
+/*
+ * Put stdout back, and pass on what solve() printed in the meantime.
+ */
+static char *
+capture_stop(size_t *len)
+{
+    char *output;
+
+    fflush(stdout);
+    dup2(capture.saved_fd, STDOUT_FILENO);
+    close(capture.saved_fd);
+    capture.active = false;
+
+    output = read_file(capture.tmp_path, len);
+    if (output != NULL) {
+        write_all(STDOUT_FILENO, output, *len);
+    }
+    return output;
+}
+
+
+/*
+ * When solve() bails out with exit(), still show what it printed, but
+ * don't keep it.
+ */
+static void
+capture_abort(void)
+{
+    size_t len;
+
+    if (capture.active) {
+        free(capture_stop(&len));
+        unlink(capture.tmp_path);
+    }
+}
+
+
+/*
+ * Stop capturing and turn the output into the cache entry. With -V,
+ * compare it against what was in the cache first, and complain (and
+ * fail) if they differ.
+ */
+static bool
+cache_store(const char *entry, const char *name)
+{
+    size_t len, old_len;
+    char *output, *old;
+    bool ok = true;
+
+    output = capture_stop(&len);
+    if (output == NULL) {
+        unlink(capture.tmp_path);
+        return true;
+    }
+    if (opts.verify) {
+        old = read_file(entry, &old_len);
+        if (old == NULL) {
+            fprintf(stderr, "No cached result for '%s' to verify.\n", name);
+        } else if (old_len != len || memcmp(old, output, len)) {
+            fprintf(stderr, "Cached result for '%s' does not match; replacing it.\n", name);
+            ok = false;
+        } else if (opts.verbose) {
+            fprintf(stderr, "Cached result for '%s' verified.\n", name);
+        }
+        free(old);
+    }
+    free(output);
+    if (rename(capture.tmp_path, entry) == -1) {
+        unlink(capture.tmp_path);
+    }
+    return ok;
+}
+
+
+/*
+ * Split the input into lines, replacing each newline by a '\0' and
+ * recording where every line starts and how long it is. A missing
+ * newline at the end of the input is fine: load_input() made sure the
+ * byte after the data can be written to.
+ */
+static void
+index_lines(struct aoc_input *in)
+{
+    char *p = in->data;
+    char *end = in->data + in->size;
+    size_t alloc = 0;
+
+    in->lines = NULL;
+    in->count = 0;
+    while (p < end) {
+        char *nl = memchr(p, '\n', end - p);
+
+        if (nl == NULL) {
+            nl = end;
+        }
+        if (in->count == alloc) {
+            alloc = alloc ? alloc * 2 : 1024;
+            in->lines = realloc(in->lines, alloc * sizeof(struct aoc_line));
+            if (in->lines == NULL) {
+                printf("Oops. Failed to allocate the line index.\n");
+                exit(1);
+            }
+        }
+        *nl = '\0';
+        in->lines[in->count].str = p;
+        in->lines[in->count].len = nl - p;
+        in->count++;
+        p = nl + 1;
+    }
+}
+
+
+/*
+ * Give back whatever load_input() and index_lines() (or open_stream())
+ * allocated.
+ */
+static void
+release_input(struct aoc_input *in)
+{
+    if (in->stream != NULL) {
+        release_stream(in);
+        return;
+    }
+    if (in->mapped) {
+        munmap(in->data, in->size);
+    } else {
+        free(in->data);
+    }
+    free(in->lines);
+}
+
+
+/*
+ * Give back what open_stream() (and aoc_token()) allocated.
+ */
+static void
+release_stream(struct aoc_input *in)
+{
+    struct aoc_stream *s = in->stream;
+
+    EVP_MD_CTX_free(s->ctx);
+    free(s->chunk);
+    free(s->token);
+    free(s);
+    in->stream = NULL;
+}
+
+
+int
+aoc_threads(void)
+{
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return threads < 1 ? 1 : threads;
+}
+
+
+/*
+ * Keep taking chunks until there are none left (or fn() called it a
+ * day), then hand in the results.
+ */
+static void *
+parallel_worker(void *arg)
+{
+    void *scratch = parallel.init != NULL ? parallel.init() : NULL;
+
+    for (;;) {
+        long from, to;
+
+        pthread_mutex_lock(&parallel.lock);
+        from = parallel.next;
+        to = parallel.total - from > parallel.chunk ? from + parallel.chunk : parallel.total;
+        parallel.next = to;
+        pthread_mutex_unlock(&parallel.lock);
+        if (from >= to) {
+            break;
+        }
+        if (!parallel.fn(scratch, from, to)) {
+            pthread_mutex_lock(&parallel.lock);
+            parallel.next = parallel.total;
+            pthread_mutex_unlock(&parallel.lock);
+        }
+    }
+    if (parallel.reduce != NULL) {
+        pthread_mutex_lock(&parallel.lock);
+        parallel.reduce(scratch);
+        pthread_mutex_unlock(&parallel.lock);
+    }
+    if (parallel.fini != NULL) {
+        parallel.fini(scratch);
+    }
+    return NULL;
+}
+
+
+void
+aoc_parallel_for(long total, long chunk,
+                 void *(*init)(void),
+                 bool (*fn)(void *scratch, long from, long to),
+                 void (*reduce)(void *scratch),
+                 void (*fini)(void *scratch))
+{
+    long threads = aoc_threads();
+    pthread_t *tids = NULL;
+
+    if (total <= 0) {
+        return;
+    }
+    if (chunk < 1) {
+        chunk = 1;
+    }
+    if (threads > (total - 1) / chunk + 1) {
+        threads = (total - 1) / chunk + 1;
+    }
+    parallel.total = total;
+    parallel.chunk = chunk;
+    parallel.next = 0;
+    parallel.init = init;
+    parallel.fn = fn;
+    parallel.reduce = reduce;
+    parallel.fini = fini;
+
+    if (threads > 1 && (tids = malloc((threads - 1) * sizeof(pthread_t))) == NULL) {
+        printf("Oops. Failed to allocate the threads.\n");
+        exit(1);
+    }
+    for (long i = 0; i < threads - 1; i++) {
+        if (pthread_create(&tids[i], NULL, parallel_worker, NULL) != 0) {
+            printf("Oops. Failed to start a worker thread.\n");
+            exit(1);
+        }
+    }
+    parallel_worker(NULL);
+    for (long i = 0; i < threads - 1; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    free(tids);
+}
+
+
+/*
+ * Minimal option parsing, shared by all the programs.
+ */
+static void
+parse_options(int *argc, char **argv[])
+{
+    int ch;
+
+    opts.debug       = false;
+    opts.dryrun      = false;
+    opts.fingerprint = false;
+    opts.nocache     = false;
+    opts.timing      = false;
+    opts.verbose     = false;
+    opts.verify      = false;
+
+    while ((ch = getopt(*argc, *argv, "CdfntvVh")) != -1) {
+        switch (ch) {
+        case 'C':
+            opts.nocache = true;
+            break;
+        case 'd':
+            opts.debug = true;
+            break;
+        case 'f':
+            opts.fingerprint = true;
+            break;
+        case 'n':
+            opts.dryrun = true;
+            break;
+        case 't':
+            opts.timing = true;
+            break;
+        case 'v':
+            opts.verbose = true;
+            break;
+        case 'V':
+            opts.verify = true;
+            break;
+        case 'h':
+            print_usage(stdout, (*argv)[0], NULL, true, EXIT_SUCCESS);
+        case '?':
+        default:
+            print_usage(stderr, (*argv)[0], "\n", false, EXIT_FAILURE);
+        }
+    }
+    *argc -= optind;
+    *argv += optind;
+}
+
+
+/*
+ * Print a minimal usage blurb for the program.
+ */
+static void
+print_usage(FILE *f, char *argv0, char *prefix, bool full, int exitcode)
+{
+    char *name;
+
+    if (prefix != NULL) {
+        fprintf(f, "%s", prefix);
+    }
+    name = basename(argv0);
+    fprintf(f, "\
+NAME\n\
+     %s - Program for AoC %s puzzles; Day %s, part %s\n\
+\n\
+SYNOPSIS\n\
+     %s [OPTIONS] [<filename> ...]\n",
+            name, aoc_program.year, aoc_program.day, aoc_program.part, name);
+    if (!full) {
+        exit(exitcode);
+    }
+    fprintf(f, "\
+\n\
+DESCRIPTION\n\
+     This program is used for one of the AoC %s puzzles; Day %s, part %s.\n\
+     If filenames are provided, it will process them, one at a time.\n\
+     Otherwise it will process whatever it will read from standard input.\n\
+\n\
+OPTIONS\n\
+     -C\n\
+        Always call the solver, without looking at or updating the result cache.\n\
+     -d\n\
+        Enable debugging output.\n\
+     -f\n\
+        Report the fingerprint (SHA-256) of each input (on stderr).\n\
+     -n\n\
+        Request dryrun (noop) mode.\n\
+     -t\n\
+        Report the time spent on each input (on stderr).\n\
+     -v\n\
+        Enable verbose output.\n\
+     -V\n\
+        Call the solver even when the result is cached, and check that the\n\
+        cached result is the same (exiting 1 if it isn't).\n\
+\n\
+ENVIRONMENT\n\
+     AOC_CACHE_DIR\n\
+        Where results are cached, keyed by the program and the fingerprint of\n\
+        the input. Defaults to $XDG_CACHE_HOME/aoc, or ~/.cache/aoc.\n\
+\n\
+EXIT STATUS\n\
+     The program exits 0 on success, and 1 when something went amiss\n\
+     with its option parsing, reading its input, or verifying a cached\n\
+     result.\n",
+            aoc_program.year, aoc_program.day, aoc_program.part);
+    exit(exitcode);
+}
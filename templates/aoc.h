@@ -0,0 +1,161 @@
+/* -*- mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- for emacs
+ *
+ * =======================================================================
+ * Shared runtime for the C AoC programs (libaoc)
+ * =======================================================================
+ *
+ * The runtime provides main(), the option parsing and the usage blurb,
+ * and takes care of loading the input files (or stdin). A program only
+ * has to declare which puzzle it is for, and supply a solve() callback:
+ *
+ *     # include "aoc.h"
+ *
+ *     AOC_PROGRAM(2023, 17, 1);
+ *
+ *     void
+ *     solve(struct aoc_input *in)
+ *     {
+ *         for (size_t lineno = 0; lineno < in->count; lineno++) {
+ *             char *buf = in->lines[lineno].str;
+ *             ...
+ *         }
+ *     }
+ *
+ * Programs whose input is one long stream of instructions, rather than
+ * lines worth keeping around, can declare themselves with
+ * AOC_STREAM_PROGRAM() instead. Their solve() gets no data or lines,
+ * but reads the input a chunk at a time with aoc_read() or aoc_token(),
+ * so it doesn't matter how big the input is.
+ */
+
+# ifndef AOC_H
+# define AOC_H
+
+# include <stdbool.h>    /* bool, true, false    */
+# include <stddef.h>     /* size_t               */
+
+# define STR(x) _STR(x)
+# define _STR(x) #x
+
+struct aoc_opts {
+    bool debug       : 1;
+    bool dryrun      : 1;
+    bool fingerprint : 1;
+    bool nocache     : 1;
+    bool timing      : 1;
+    bool verbose     : 1;
+    bool verify      : 1;
+};
+
+extern struct aoc_opts opts;
+
+struct aoc_program {
+    const char *year;
+    const char *day;
+    const char *part;
+    bool        stream;
+};
+
+extern const struct aoc_program aoc_program;
+
+/*
+ * The arguments are stringified rather than evaluated, so a day like
+ * 08 can be written the way the directory is named.
+ */
+# define AOC_PROGRAM(year, day, part) \
+    const struct aoc_program aoc_program = { STR(year), STR(day), STR(part), false }
+
+# define AOC_STREAM_PROGRAM(year, day, part) \
+    const struct aoc_program aoc_program = { STR(year), STR(day), STR(part), true }
+
+/*
+ * A line of the input. The string points into the input buffer (no
+ * copy is made), and the newline has been replaced by a '\0', so it
+ * can be used as a regular (writable) C string as well.
+ */
+struct aoc_line {
+    char   *str;
+    size_t  len;
+};
+
+/* The input fingerprint is a SHA-256 digest of the whole input */
+# define AOC_DIGEST_LENGTH 32
+
+/* How much of a streamed input is in memory at any one time */
+# define AOC_CHUNK_SIZE (1 << 20)
+
+struct aoc_stream;
+
+/*
+ * The whole input, as loaded by the runtime. When reading from a file
+ * the data is memory mapped, otherwise it's read into memory in bulk.
+ * Either way it's only valid for the duration of the solve() call.
+ *
+ * For a streaming program, data and lines are NULL instead, and size
+ * is the number of bytes read so far.
+ *
+ * The digest is only calculated (while loading) when something needs
+ * it, in which case digested is set.
+ */
+struct aoc_input {
+    const char      *name;
+    char            *data;
+    size_t           size;
+    struct aoc_line *lines;
+    size_t           count;
+    bool             mapped;
+    bool             digested;
+    unsigned char    digest[AOC_DIGEST_LENGTH];
+    char             hexdigest[AOC_DIGEST_LENGTH * 2 + 1];
+    struct aoc_stream *stream;
+};
+
+/*
+ * For streaming programs: hand out the next chunk of the input (which
+ * is writable, and followed by a '\0'), returning its length, or 0 at
+ * the end of the input. The chunk is only valid until the next call.
+ */
+size_t aoc_read(struct aoc_input *in, char **chunk);
+
+/*
+ * For streaming programs: get the next token of the input, up to (not
+ * including) any of the characters in seps, or the end of the input.
+ * The token is '\0' terminated, and only valid until the next call.
+ * Tokens can be empty (between two separators), but an input that ends
+ * with a separator doesn't have an empty token after it. Returns false
+ * at the end of the input.
+ */
+bool aoc_token(struct aoc_input *in, const char *seps, struct aoc_line *token);
+
+/*
+ * The number of threads worth running: one per processor.
+ */
+int aoc_threads(void);
+
+/*
+ * Call fn() for the range 0 .. total - 1, in pieces of (at most) chunk,
+ * on a thread per processor (or fewer, when there aren't that many
+ * chunks). The threads take the next chunk from a shared counter as
+ * soon as they're done with one, the calling thread included.
+ *
+ * Every thread gets its own scratch from init() (NULL if there's no
+ * init()), which it passes to fn(). Once it runs out of chunks, that
+ * goes to reduce(), with the other threads held off, so it can add what
+ * the thread found to the overall result, and then to fini() to clean
+ * up. Any of init(), reduce() and fini() can be NULL.
+ *
+ * When fn() returns false, no more chunks are handed out, but the ones
+ * other threads are working on are finished. Not for nested use.
+ */
+void aoc_parallel_for(long total, long chunk,
+                      void *(*init)(void),
+                      bool (*fn)(void *scratch, long from, long to),
+                      void (*reduce)(void *scratch),
+                      void (*fini)(void *scratch));
+
+/*
+ * Supplied by the program; called once for every input.
+ */
+void solve(struct aoc_input *in);
+
+# endif /* AOC_H */
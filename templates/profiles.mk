@@ -0,0 +1,52 @@
+# Build profiles, shared by the per-day Makefiles and the top level
+# one. Pick one with PROFILE=<name> on the make command line:
+#
+#   debug    No optimization (the default)
+#   release  -O3
+#   lto      -O3 with link time optimization
+#   native   -O3 tuned for (and only runnable on) this CPU
+#   pgo      -O3 with profile guided optimization: an instrumented
+#            build is run over the local input files first (see
+#            PGO_INPUTS in the Makefile), then the program is rebuilt
+#            using the profile that produced.
+#
+# All of them keep -g, so there's always something to debug with.
+
+PROFILE?=debug
+
+PROFILES=debug release lto native pgo
+
+ifeq ($(filter $(PROFILE),$(PROFILES)),)
+$(error Unknown PROFILE '$(PROFILE)', expected one of: $(PROFILES))
+endif
+
+PROFILE_CFLAGS_debug=-g -O0
+PROFILE_CFLAGS_release=-g -O3
+PROFILE_CFLAGS_lto=-g -O3 -flto
+PROFILE_CFLAGS_native=-g -O3 -march=native
+PROFILE_CFLAGS_pgo=-g -O3
+
+PROFILE_LDFLAGS_lto=-flto
+
+PROFILE_CFLAGS=$(PROFILE_CFLAGS_$(PROFILE))
+PROFILE_LDFLAGS=$(PROFILE_LDFLAGS_$(PROFILE))
+
+# With LTO the archive needs an index of the (intermediate) objects,
+# which only the compiler's own ar wrapper knows how to make.
+ifeq ($(PROFILE),lto)
+ifneq ($(findstring clang,$(shell $(CC) --version 2>/dev/null)),)
+AR=llvm-ar
+else
+AR=gcc-ar
+endif
+endif
+
+# clang writes raw profiles, which need merging before they can be used
+ifneq ($(findstring clang,$(shell $(CC) --version 2>/dev/null)),)
+PGO_CLANG=yes
+ifeq ($(shell uname -s),Darwin)
+LLVM_PROFDATA=xcrun llvm-profdata
+else
+LLVM_PROFDATA=llvm-profdata
+endif
+endif